@@ -0,0 +1,277 @@
+/*
+ * animation.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Animation playback for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <algorithm>
+
+// Qt
+#include <QImageReader>
+#include <QRunnable>
+
+#include "animation.h"
+#include "cache.h"
+#include "mapped.h"
+#include "scale.h"
+#include "trace.h"
+
+class FrameTask : public QRunnable {
+public:
+	// A {reframe} decodes every frame again at the animation's current size and swaps them in for
+	// the frames kept in memory, leaving playback where it is
+	FrameTask(Animation* _anim, int _generation, const fs::path &_file, bool _reframe = false) :
+		anim(_anim), generation(_generation), file(_file), reframe(_reframe) {}
+
+	void run() override {
+		// Mapped once, every loop while streaming decodes again straight from the page cache
+		MappedFile mapped(file);
+		if (reframe) {
+			again(mapped);
+			return;
+		}
+		do {
+			QImageReader reader;
+			mapped.attach(reader);
+			QImage image;
+			int n = 0;
+			while (anim->isCurrent(generation) && reader.read(&image)) {
+				if (!anim->push(generation, scaled(image, anim->frameSize()), delay(reader))) return;
+				n ++;
+			}
+			if (n == 0) {
+				anim->finish(generation);
+				return;
+			}
+		} while (!anim->finish(generation));
+
+		// The window grew while the first pass was decoding, some frames are smaller than they should be
+		if (anim->isStale(generation)) again(mapped);
+	}
+
+private:
+	void again(MappedFile &mapped) {
+		int serial = anim->reframes.load();
+		QSize size = anim->frameSize();
+		QImageReader reader;
+		mapped.attach(reader);
+		QImage image;
+		std::deque<Animation::Frame> frames;
+		size_t bytes = 0;
+		while (reader.read(&image)) {
+			if (!anim->isCurrent(generation) || anim->reframes.load() != serial) return;
+			frames.push_back({scaled(image, size), delay(reader)});
+
+			// Both sets are held until the swap, give up rather than go over
+			bytes += frames.back().image.byteCount();
+			if (bytes > anim->budget || bytes > Governor::instance().headroom()) return;
+		}
+		anim->replace(generation, size, std::move(frames));
+	}
+
+	static QImage scaled(const QImage &image, const QSize &size) {
+		TRACE_SCOPE("animationFrame");
+		return scale::downscale(image, ImageCache::fitted(image.size(), size));
+	}
+
+	// Delay of the frame just read. Like browsers, treat the tiny ones as unset
+	static int delay(const QImageReader &reader) {
+		int d = reader.nextImageDelay();
+		return d <= 10 ? 100 : d;
+	}
+
+	Animation* anim;
+	int generation;
+	fs::path file;
+	bool reframe;
+};
+
+Animation::Animation(QObject* parent) : QObject(parent), generation(0) {
+	timer = new QTimer(this);
+	timer->setSingleShot(true);
+	timer->setTimerType(Qt::PreciseTimer);
+	connect(timer, &QTimer::timeout, this, &Animation::advance);
+	connect(this, &Animation::decoded, this, &Animation::resume, Qt::QueuedConnection);
+
+	// One decoder at a time, plus one still winding down from the last animation
+	pool.setMaxThreadCount(2);
+	clock.start();
+
+	// Counted, but not evicted from. Over the cap, animations stream instead of being kept
+	client = Governor::instance().enroll("animation", 2);
+}
+Animation::~Animation() {
+	stop();
+	pool.waitForDone();
+	Governor::instance().leave(client);
+}
+
+void Animation::play(const fs::path &_file, const QSize &target) {
+	fs::path f(_file);
+	stop();
+	file = f;
+
+	QImageReader reader(QString::fromStdString(file.string()));
+	_native = reader.size();
+	{
+		QMutexLocker lock(&mutex);
+		size = _native.isValid() ? ImageCache::fitted(_native, target) : target;
+	}
+	due = -1;
+	pool.start(new FrameTask(this, generation, file));
+}
+
+void Animation::stop() {
+	timer->stop();
+	file = fs::path();
+
+	// Decoders of the old generation drop out at their next [push], including one blocked on [space]
+	QMutexLocker lock(&mutex);
+	++generation;
+	space.wakeAll();
+	frames.clear();
+	bytes = 0;
+	held = 0;
+	Governor::instance().report(client, 0);
+	pos = 0;
+	complete = streaming = stale = false;
+	waiting = true;
+}
+
+void Animation::resize(const QSize &target) {
+	if (file.empty()) return;
+
+	// Frames larger than needed are shrunk by the canvas as they're shown, only growing decodes again.
+	// Never from the start: the frames in hand play on, scaled up, until larger ones replace them
+	QSize want = _native.isValid() ? ImageCache::fitted(_native, target) : target;
+	QMutexLocker lock(&mutex);
+	if (want.width() <= size.width() && want.height() <= size.height()) return;
+	size = want;
+	reframes ++;
+
+	// Streaming decodes every loop anyway, the next one comes at [size]. Frames kept in memory are
+	// decoded again in the background, or once the first pass is done if it's still running
+	if (streaming) return;
+	if (complete) pool.start(new FrameTask(this, generation, file, true));
+	else stale = true;
+}
+
+QSize Animation::frameSize() {
+	QMutexLocker lock(&mutex);
+	return size;
+}
+
+bool Animation::isStale(int g) {
+	QMutexLocker lock(&mutex);
+	if (!isCurrent(g)) return false;
+	bool s = complete && !streaming && stale;
+	stale = false;
+	return s;
+}
+
+void Animation::replace(int g, const QSize &s, std::deque<Frame> &&f) {
+	QMutexLocker lock(&mutex);
+	// Superseded by another resize, or no longer the frames being replayed from memory
+	if (!isCurrent(g) || s != size || streaming || !complete || f.size() != frames.size()) return;
+	frames.swap(f);
+	size_t b = 0;
+	for (const auto &e : frames) b += e.image.byteCount();
+	bytes = held = b;
+	Governor::instance().report(client, held);
+}
+
+void Animation::advance() {
+	Frame f;
+	bool single;
+	{
+		QMutexLocker lock(&mutex);
+		if (streaming) {
+			if (frames.empty()) {
+				waiting = true;
+				return;
+			}
+			f = frames.front();
+			frames.pop_front();
+			held -= f.image.byteCount();
+			Governor::instance().report(client, held);
+			space.wakeAll();
+		}
+		else {
+			if (pos >= frames.size()) {
+				if (!complete) {
+					waiting = true;
+					return;
+				}
+				if (frames.empty()) return;
+
+				// Every loop after the first comes from memory
+				pos = 0;
+			}
+			f = frames[pos++];
+		}
+		single = complete && frames.size() == 1;
+	}
+	emit frame(f.image);
+	if (single) return;
+
+	// Schedule against when this frame was due rather than when it went up, so delays don't
+	// drift. After a stall (waiting on the decoder) restart the schedule instead of rushing
+	qint64 now = clock.elapsed();
+	if (due < 0 || now - due > 250) due = now;
+	due += f.delay;
+	timer->start(std::max<qint64>(0, due - now));
+}
+
+void Animation::resume(int g) {
+	if (isCurrent(g)) advance();
+}
+
+bool Animation::push(int g, const QImage &image, int delay) {
+	QMutexLocker lock(&mutex);
+	if (!isCurrent(g)) return false;
+
+	size_t b = image.byteCount();
+	if (!streaming) {
+		if (bytes + b <= budget && b <= Governor::instance().headroom()) bytes += b;
+		else {
+			// Too large to keep, drop what has been shown and stream from here on
+			streaming = true;
+			auto shown = frames.begin() + std::min(pos, frames.size());
+			for (auto it = frames.begin(); it != shown; ++it) held -= it->image.byteCount();
+			frames.erase(frames.begin(), shown);
+			pos = 0;
+			bytes = 0;
+		}
+	}
+	while (streaming && frames.size() >= size_t(queue_depth)) {
+		space.wait(&mutex);
+		if (!isCurrent(g)) return false;
+	}
+
+	frames.push_back({image, delay});
+	held += b;
+	Governor::instance().report(client, held);
+	if (waiting) {
+		waiting = false;
+		emit decoded(g);
+	}
+	return true;
+}
+
+bool Animation::finish(int g) {
+	QMutexLocker lock(&mutex);
+	if (!isCurrent(g)) return true;
+	if (streaming) return false;
+
+	complete = true;
+	if (waiting) {
+		waiting = false;
+		emit decoded(g);
+	}
+	return true;
+}
@@ -0,0 +1,108 @@
+/*
+ * animation.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Animation playback for PicoView minimal image viewer. Frames are
+ * decoded once, off the GUI thread, already scaled for display, and
+ * later loops play from memory. Animations too large for the frame
+ * budget stream through a short queue instead
+ *
+ */
+
+#pragma once
+
+// std
+#include <atomic>
+#include <deque>
+#include <experimental/filesystem>
+
+// Qt
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QSize>
+#include <QThreadPool>
+#include <QTimer>
+#include <QWaitCondition>
+
+#include "governor.h"
+
+namespace fs = std::experimental::filesystem;
+
+class Animation : public QObject {
+	Q_OBJECT
+
+public:
+	Animation(QObject* parent = Q_NULLPTR);
+	~Animation();
+
+	// Start playing {f} from its first frame, decoded to fit {target}
+	void play(const fs::path &f, const QSize &target);
+	void stop();
+
+	// Decode again for {target} if the frames in hand don't fit it, without interrupting playback
+	void resize(const QSize &target);
+
+	bool isPlaying() const { return !file.empty(); }
+	QSize native() const { return _native; }
+
+	// Bytes of decoded frames kept for replaying, 128 MB by default. Frames are only kept
+	// while the [Governor] has room for them too
+	void setBudget(size_t b) { budget = b; }
+
+	static const int queue_depth = 8;   // Frames decoded ahead while streaming
+
+signals:
+	void frame(const QImage &image);
+	void decoded(int g);                // From the decoder when [advance] is waiting on it
+
+private slots:
+	void advance();
+	void resume(int g);
+
+private:
+	friend class FrameTask;
+
+	struct Frame {
+		QImage image;
+		int delay;                      // Milliseconds to show it for
+	};
+
+	// From the decoder: [push] is false once {g} is no longer current, [finish]
+	// is false if the frames weren't kept and the file has to be decoded again
+	bool push(int g, const QImage &image, int delay);
+	bool finish(int g);
+	bool isCurrent(int g) const { return g == generation.load(); }
+
+	// For [resize]'s background decodes: the size to decode at, whether the first pass of {g}
+	// finished with frames smaller than that, and the frames at size {s} to replay from now on
+	QSize frameSize();
+	bool isStale(int g);
+	void replace(int g, const QSize &s, std::deque<Frame> &&f);
+
+	fs::path file;
+	QSize size;                         // Size frames are decoded at, under [mutex]
+	QSize _native;
+	size_t budget = size_t(128) << 20;
+	QTimer* timer;
+	QElapsedTimer clock;
+	qint64 due = -1;                    // When the frame on screen should be replaced, on [clock]
+
+	QMutex mutex;
+	QWaitCondition space;               // Signalled as the player takes frames while streaming
+	std::deque<Frame> frames;
+	size_t bytes = 0;                   // Of the frames kept for replaying, against [budget]
+	size_t held = 0;                    // Of every frame in [frames], as reported to the [Governor]
+	size_t pos = 0;                     // Next frame to show when replaying from memory
+	bool complete = false;              // All frames are in [frames]
+	bool streaming = false;             // Over [budget], [frames] is a queue the decoder refills every loop
+	bool waiting = false;               // [advance] found nothing to show and waits for [push]
+	bool stale = false;                 // [size] grew while the first pass was being decoded
+	std::atomic<int> reframes{0};       // Bumped by every [resize], abandons older decodes for it
+	std::atomic<int> generation;
+	QThreadPool pool;
+	Governor::Client* client;
+};
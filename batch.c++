@@ -0,0 +1,249 @@
+/*
+ * batch.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Headless batch processing for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Qt
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImageWriter>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include "batch.h"
+#include "filelist.h"
+#include "loader.h"
+#include "picoview.h"
+#include "thumbs.h"
+#include "trash.h"
+
+namespace batch {
+
+namespace {
+
+// Thumbnail packs held open at once, each is a descriptor and a mapping or two
+const size_t open_limit = 256;
+
+struct Stats {
+	std::atomic<size_t> images{0};
+	std::atomic<size_t> skipped{0};
+	std::atomic<size_t> failed{0};
+	std::atomic<uint64_t> read{0};      // Source bytes of the images processed
+	std::atomic<uint64_t> written{0};
+};
+
+struct Job {
+	FileEntry entry;
+	fs::path out;
+};
+
+class ResizeTask : public QRunnable {
+public:
+	ResizeTask(const Job &_job, const QSize &_target, const QByteArray &_format, int _quality, Stats &_stats) :
+		job(_job), target(_target), format(_format), quality(_quality), stats(_stats) {}
+
+	void run() override {
+		// Reduced decode and the viewer's downscaler, exactly as it would be shown
+		Decoded d = Loader::decode(job.entry.path, target);
+		std::error_code ec;
+		fs::create_directories(job.out.parent_path(), ec);
+		QImageWriter writer(QString::fromStdString(job.out.string()), format);
+		writer.setQuality(quality);
+		if (d.image.isNull() || !writer.write(d.image)) {
+			fprintf(stderr, "Failed: %s\n", job.entry.path.c_str());
+			stats.failed ++;
+			return;
+		}
+		stats.images ++;
+		stats.read += job.entry.size;
+		stats.written += fs::file_size(job.out, ec);
+	}
+
+private:
+	Job job;
+	QSize target;
+	QByteArray format;
+	int quality;
+	Stats &stats;
+};
+
+// Every image under {root} in a supported format, skipping videos, trash and {exclude}
+std::vector<FileEntry> walk(const fs::path &root, const fs::path &exclude) {
+	std::vector<FileEntry> found;
+	std::error_code ec;
+	fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+	for (; !ec && it != end; it.increment(ec)) {
+		const fs::path &p = it->path();
+		if (it->status(ec).type() == fs::file_type::directory) {
+			if (p.filename() == Trash::name || p == exclude) it.disable_recursion_pending();
+			continue;
+		}
+		std::string ext = tolower(p.extension().string());
+		if (ext == ".mp4" || !supportedFormats().count(ext)) continue;
+		found.push_back(FileEntry::stat(p, ext));
+	}
+	return found;
+}
+
+void report(const Stats &s, qint64 ms) {
+	double secs = std::max<qint64>(ms, 1) / 1000.0;
+	printf("%zu images, %zu skipped, %zu failed in %.2f s\n", s.images.load(), s.skipped.load(), s.failed.load(), secs);
+	printf("%.1f images/s, %.1f MB/s read, %.1f MB/s written\n", s.images / secs,
+		s.read / secs / (1 << 20), s.written / secs / (1 << 20));
+}
+
+}
+
+int run(int argn, char** argv) {
+	QCoreApplication a(argn, argv);
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Batch thumbnailing, resizing and conversion for PicoView");
+	parser.addHelpOption();
+	parser.addPositionalArgument("dirs", "Directory trees to process.", "dirs...");
+	parser.addOption({"batch", "Run headless, over {dirs}."});
+	parser.addOption({"thumbs", "Fill the viewer's thumbnail cache for every directory."});
+	parser.addOption({"output", "Write resized copies under {dir}, mirroring each tree.", "dir"});
+	parser.addOption({"size", "Longest edge of the resized copies.", "px", "1920"});
+	parser.addOption({"format", "Format of the resized copies, by default that of each source.", "ext"});
+	parser.addOption({"quality", "Encoder quality of the resized copies, 0 to 100.", "q", "90"});
+	parser.addOption({"threads", "Worker threads, every core by default.", "n"});
+	parser.process(a);
+
+	QStringList dirs = parser.positionalArguments();
+	bool thumbs = parser.isSet("thumbs");
+	if (dirs.isEmpty() || thumbs == parser.isSet("output")) {
+		fprintf(stderr, "Give one of --thumbs or --output, and at least one directory\n");
+		return 1;
+	}
+
+	Stats stats;
+	QElapsedTimer clock;
+	clock.start();
+
+	fs::path out;
+	if (!thumbs) {
+		out = fs::absolute(parser.value("output").toStdString());
+		std::error_code ec;
+		fs::create_directories(out, ec);
+		out = fs::canonical(out, ec);
+	}
+
+	std::vector<std::pair<fs::path, std::vector<FileEntry>>> trees;
+	for (const auto &d : dirs) {
+		std::error_code ec;
+		fs::path root = fs::canonical(d.toStdString(), ec);
+		if (ec || !fs::is_directory(root, ec)) {
+			fprintf(stderr, "Not a directory: %s\n", qPrintable(d));
+			continue;
+		}
+		trees.push_back({root, walk(root, out)});
+	}
+
+	// Not the global pool, the downscaler splits large images across that one
+	QThreadPool pool;
+	int threads = parser.value("threads").toInt();
+	pool.setMaxThreadCount(threads > 0 ? threads : QThread::idealThreadCount());
+
+	if (thumbs) {
+		std::unordered_map<std::string, const FileEntry*> by_path;
+		for (const auto &t : trees) {
+			for (const auto &e : t.second) by_path[e.path.string()] = &e;
+		}
+
+		// A cache per directory, all on the one pool, so nothing waits for a directory's stragglers
+		// before starting on the next. Only every [open_limit] directories is the pool drained and
+		// their packs closed, which keeps the descriptors and mappings held in bounds
+		std::vector<std::unique_ptr<ThumbCache>> caches;
+		for (const auto &t : trees) {
+			std::map<fs::path, std::vector<const FileEntry*>> by_dir;
+			for (const auto &e : t.second) by_dir[e.path.parent_path()].push_back(&e);
+			for (const auto &d : by_dir) {
+				if (caches.size() == open_limit) {
+					pool.waitForDone();
+					caches.clear();
+				}
+				caches.emplace_back(new ThumbCache(nullptr, &pool));
+				ThumbCache* cache = caches.back().get();
+				cache->open(d.first);
+
+				// Counted as each one is stored, or found undecodable, from the worker that did it
+				QObject::connect(cache, &ThumbCache::ready, [cache, &by_path, &stats](QString path) {
+					const FileEntry* e = by_path.at(path.toStdString());
+					if (cache->find(*e).isNull()) {
+						fprintf(stderr, "Failed: %s\n", e->path.c_str());
+						stats.failed ++;
+						return;
+					}
+					stats.images ++;
+					stats.read += e->size;
+				});
+				for (const FileEntry* e : d.second) {
+					if (!cache->find(*e).isNull()) stats.skipped ++;
+					else cache->request(*e);
+				}
+			}
+		}
+		pool.waitForDone();
+		caches.clear();
+		report(stats, clock.elapsed());
+		return 0;
+	}
+
+	int edge = std::max(1, parser.value("size").toInt());
+	QSize target(edge, edge);
+	int quality = std::min(100, std::max(0, parser.value("quality").toInt()));
+	std::string format = tolower(parser.value("format").toStdString());
+	if (!format.empty() && format[0] != '.') format = "."+format;
+
+	std::unordered_set<std::string> writable;
+	for (const auto &f : QImageWriter::supportedImageFormats()) writable.insert("."+f.toStdString());
+	if (!format.empty() && !writable.count(format)) {
+		fprintf(stderr, "Can't write %s\n", format.c_str());
+		return 1;
+	}
+
+	for (const auto &t : trees) {
+		// Trees keep their own name under {out} when there's more than one
+		fs::path base = trees.size() > 1 ? out / t.first.filename() : out;
+		size_t prefix = t.first.string().size() + 1;
+		for (const auto &e : t.second) {
+			// Sources Qt can only read (gif, svg, ...) are written as png
+			std::string ext = format.empty() ? e.ext : format;
+			if (!writable.count(ext)) ext = ".png";
+			fs::path dst = base / e.path.string().substr(prefix);
+			dst.replace_extension(ext);
+
+			// Already done on an earlier run, and the source hasn't changed since
+			std::error_code ec;
+			if (fs::exists(dst, ec) && fs::last_write_time(dst, ec) >= fs::last_write_time(e.path, ec)) {
+				stats.skipped ++;
+				continue;
+			}
+			QByteArray fmt = QByteArray::fromStdString(dst.extension().string().substr(1));
+			pool.start(new ResizeTask({e, dst}, target, fmt, quality, stats));
+		}
+	}
+	pool.waitForDone();
+	report(stats, clock.elapsed());
+	return stats.failed ? 2 : 0;
+}
+
+}
@@ -0,0 +1,21 @@
+/*
+ * batch.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Headless batch processing for PicoView minimal image viewer. Walks
+ * directory trees and, on every core, either fills the viewer's own
+ * thumbnail cache or writes resized and converted copies, using the
+ * same decode and scale paths as the viewer
+ *
+ */
+
+#pragma once
+
+namespace batch {
+
+// Entry point for `picoview --batch`, returns the exit code. Creates no widgets
+int run(int argn, char** argv);
+
+}
@@ -0,0 +1,355 @@
+/*
+ * bench.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Headless benchmarks for PicoView minimal image viewer. Generates a
+ * synthetic corpus of each requested size, drives the viewer offscreen
+ * through its hot paths and writes the timings as JSON
+ *
+ */
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+// Qt
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QTemporaryDir>
+
+#include "picoview.h"
+#include "scale.h"
+
+// Two frame 1x1 GIF with a NETSCAPE loop extension, Qt can read GIFs but not write them
+static const unsigned char gif[] = {
+	'G', 'I', 'F', '8', '9', 'a', 0x01, 0x00, 0x01, 0x00, 0x80, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0xff, 0xff, 0xff,
+	0x21, 0xff, 0x0b, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00,
+	0x21, 0xf9, 0x04, 0x00, 0x0a, 0x00, 0x00, 0x00,
+	0x2c, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x02, 0x02, 0x44, 0x01, 0x00,
+	0x21, 0xf9, 0x04, 0x00, 0x0a, 0x00, 0x00, 0x00,
+	0x2c, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x02, 0x02, 0x4c, 0x01, 0x00,
+	0x3b
+};
+
+// ISO BMFF box {type} around {payload}
+static QByteArray box(const char* type, const QByteArray &payload) {
+	QByteArray b(8, '\0');
+	uint32_t size = 8 + payload.size();
+	for (int ii = 0; ii < 4; ii ++) b[ii] = char(size >> (24 - 8 * ii));
+	b.replace(4, 4, type, 4);
+	return b + payload;
+}
+
+static void be32(QByteArray &b, int at, uint32_t v) {
+	for (int ii = 0; ii < 4; ii ++) b[at + ii] = char(v >> (24 - 8 * ii));
+}
+
+// Header-only MP4 (ftyp, then moov with one video track) that [media::probe] classifies fully
+static QByteArray mp4(int width, int height) {
+	QByteArray ftyp("isom\0\0\0\0isomavc1", 16);
+
+	QByteArray mvhd(100, '\0');
+	be32(mvhd, 12, 1000);
+	be32(mvhd, 16, 5000);
+
+	QByteArray tkhd(84, '\0');
+	be32(tkhd, 76, uint32_t(width) << 16);
+	be32(tkhd, 80, uint32_t(height) << 16);
+
+	QByteArray hdlr(25, '\0');
+	hdlr.replace(8, 4, "vide", 4);
+
+	return box("ftyp", ftyp) + box("moov", box("mvhd", mvhd) + box("trak", box("tkhd", tkhd) + box("mdia", box("hdlr", hdlr))));
+}
+
+// Gradient with some structure, so encoders produce realistic rather than trivial output
+static QByteArray encode(const QSize &size, const char* format) {
+	QImage img(size, QImage::Format_RGB32);
+	QLinearGradient g(0, 0, size.width(), size.height());
+	g.setColorAt(0, QColor(30, 60, 120));
+	g.setColorAt(1, QColor(220, 180, 90));
+	QPainter p(&img);
+	p.fillRect(img.rect(), g);
+	p.setPen(QPen(QColor(255, 255, 255, 120), 3));
+	for (int ii = 0; ii < size.width(); ii += 37) p.drawLine(ii, 0, size.width() - ii, size.height());
+	p.end();
+
+	QByteArray data;
+	QBuffer buffer(&data);
+	buffer.open(QIODevice::WriteOnly);
+	img.save(&buffer, format, 85);
+	return data;
+}
+
+static void write(const fs::path &p, const QByteArray &data) {
+	FILE* f = fopen(p.c_str(), "wb");
+	if (!f) return;
+	fwrite(data.constData(), 1, data.size(), f);
+	fclose(f);
+}
+
+class Bench {
+public:
+	Bench(PicoView &_view, int _iterations) : view(_view), iterations(_iterations) {}
+
+	// Fill {dir} with {n} files: mostly small JPEGs and PNGs, some BMPs, animated GIFs and MP4s,
+	// under scrambled names and spread out mtimes so every [SortMode] has work to do
+	static void corpus(const fs::path &dir, size_t n);
+
+	void run(const fs::path &dir, size_t n);
+
+	QJsonArray results;
+
+private:
+	// Time {fn} [iterations] times, running {setup} untimed before each
+	void measure(const QString &name, size_t n, std::function<void()> fn, std::function<void()> setup = nullptr);
+
+	void listed();                      // Wait for [view] to have the whole directory
+	void presented();                   // Wait for [view]'s outstanding decode to be shown
+	void animated(long i);              // Show animation {i} and wait for its first frame
+	void played(long i);                // Show video {i} and wait for the player to buffer it
+	long find(MediaClass kind, long after = -1);
+
+	PicoView &view;
+	int iterations;
+};
+
+void Bench::corpus(const fs::path &dir, size_t n) {
+	fs::create_directories(dir);
+	std::vector<QSize> sizes = {QSize(320, 240), QSize(800, 600), QSize(1600, 1200)};
+	std::vector<QByteArray> jpg, png, bmp;
+	for (const auto &s : sizes) {
+		jpg.push_back(encode(s, "JPG"));
+		png.push_back(encode(s, "PNG"));
+		bmp.push_back(encode(s, "BMP"));
+	}
+	QByteArray anim(reinterpret_cast<const char*>(gif), sizeof(gif));
+	QByteArray video = mp4(1920, 1080);
+
+	// One large photo for the scaling benchmarks
+	write(dir / "0_large.jpg", encode(QSize(6000, 4000), "JPG"));
+
+	auto now = fs::file_time_type::clock::now();
+	for (size_t ii = 1; ii < n; ii ++) {
+		// Knuth's multiplicative hash scrambles names against creation order
+		uint32_t h = uint32_t(ii) * 2654435761u;
+		size_t s = h % 20 == 0 ? 2 : h % 4 == 0 ? 1 : 0;
+		char name[32];
+		const QByteArray* data;
+		switch (ii % 20) {
+			case 0:  snprintf(name, sizeof(name), "%08x.gif", h); data = &anim; break;
+			case 1:  snprintf(name, sizeof(name), "%08x.mp4", h); data = &video; break;
+			case 2:  snprintf(name, sizeof(name), "%08x.bmp", h); data = &bmp[s]; break;
+			case 3: case 4: case 5: case 6: case 7: case 8: case 9: case 10:
+			         snprintf(name, sizeof(name), "%08x.png", h); data = &png[s]; break;
+			default: snprintf(name, sizeof(name), "%08x.jpg", h); data = &jpg[s]; break;
+		}
+		fs::path p = dir / name;
+		write(p, *data);
+		fs::last_write_time(p, now - std::chrono::seconds(h % 10000000));
+	}
+}
+
+void Bench::run(const fs::path &dir, size_t n) {
+	// No read-ahead, it would only compete with the decodes being timed
+	view.lookahead = view.lookbehind = 0;
+	size_t budget = view.loader->cache()->budget();
+
+	// Listing, from a cold scan and then from the index the scan left behind. Touching the
+	// directory moves its mtime, which is all it takes to invalidate the index
+	fs::path touch = dir / ".touch";
+	measure("open_dir/scan", n, [&]() { view.open(dir); listed(); }, [&]() {
+		write(touch, QByteArray());
+		fs::remove(touch);
+	});
+	measure("open_dir/index", n, [&]() { view.open(dir); listed(); });
+	measure("getFileList", n, [&]() { view.getFileList(); });
+
+	view.current(0);
+	presented();
+	for (const auto &m : view._sort_options) {
+		QString s = QString::fromStdString(m.first);
+		measure("sortby/"+s, n, [&]() { view.sortby(s); presented(); });
+	}
+
+	// Every sample on a different file with the cache off, then one file over and over from the cache
+	long still = find(MediaClass::still);
+	view.loader->cache()->setBudget(0);
+	measure("current/still", n, [&]() { view.current(still); presented(); }, [&]() { still = find(MediaClass::still, still); });
+	view.loader->cache()->setBudget(budget);
+	view.current(still);
+	presented();
+	measure("current/still_cached", n, [&]() { view.current(still); presented(); });
+
+	long anim = find(MediaClass::animation);
+	measure("current/animation", n, [&]() { animated(anim); }, [&]() { view.current(still); presented(); });
+	long video = find(MediaClass::video);
+	measure("current/video", n, [&]() { played(video); }, [&]() { view.current(still); presented(); });
+	view.current(still);
+	presented();
+
+	// Decoding straight to display size against decoding in full and scaling afterwards
+	fs::path large = dir / "0_large.jpg";
+	QSize target(1600, 900);
+	measure("scale/decode_fitted", n, [&]() { Loader::decode(large, target); });
+	QImage native = Loader::decode(large, QSize()).image;
+	measure("scale/smooth", n, [&]() { native.scaled(target, Qt::KeepAspectRatio, Qt::SmoothTransformation); });
+	measure("scale/downscale", n, [&]() { scale::downscale(native, ImageCache::fitted(native.size(), target)); });
+	measure("scale/fast", n, [&]() { native.scaled(target, Qt::KeepAspectRatio, Qt::FastTransformation); });
+
+	// Classification sweeps over the whole listing, cold (re-listed, nothing sniffed yet) and cached
+	auto sweep = [&]() { for (const auto &e : view.files) view.isMovie(e.path); };
+	measure("isMovie/cold", n, sweep, [&]() { view.getFileList(); });
+	measure("isMovie/cached", n, sweep);
+	measure("extractResolution", n, [&]() {
+		for (const auto &e : view.files) {
+			if (e.ext == ".mp4") view.extractResolution(e.path);
+		}
+	}, [&]() { view.getFileList(); });
+}
+
+void Bench::measure(const QString &name, size_t n, std::function<void()> fn, std::function<void()> setup) {
+	std::vector<double> ms;
+	for (int ii = 0; ii < iterations; ii ++) {
+		if (setup) setup();
+		QElapsedTimer t;
+		t.start();
+		fn();
+		ms.push_back(t.nsecsElapsed() / 1e6);
+	}
+	std::sort(ms.begin(), ms.end());
+	double sum = 0;
+	for (double m : ms) sum += m;
+
+	QJsonObject r;
+	r["name"] = name;
+	r["corpus"] = qint64(n);
+	r["samples"] = int(ms.size());
+	r["min_ms"] = ms.front();
+	r["median_ms"] = ms[ms.size() / 2];
+	r["mean_ms"] = sum / ms.size();
+	r["max_ms"] = ms.back();
+	results.append(r);
+	fprintf(stderr, "%-24s %8zu  %10.3f ms\n", name.toStdString().c_str(), n, ms[ms.size() / 2]);
+}
+
+void Bench::listed() {
+	while (!view.listed) {
+		// [DirScanner::finished] is already queued once the scanner stops running
+		if (!view.scanner->isScanning()) {
+			QCoreApplication::processEvents();
+			break;
+		}
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+	}
+}
+
+void Bench::presented() {
+	if (view.pending < 0) return;
+	QEventLoop loop;
+	QObject::connect(view.loader, &Loader::decoded, &loop, [&]() { if (view.pending < 0) loop.quit(); });
+	QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+	loop.exec();
+}
+
+void Bench::animated(long i) {
+	// Until something is on screen, not just until playback has been started
+	bool shown = false;
+	QEventLoop loop;
+	QObject::connect(view.anim, &Animation::frame, &loop, [&]() { shown = true; loop.quit(); });
+	view.current(i);
+	if (shown) return;
+	QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+	loop.exec();
+}
+
+void Bench::played(long i) {
+	// The corpus videos are headers only, so the backend gets as far as finding them unplayable
+	view.current(i);
+	QMediaPlayer* player = view.player;
+	auto settled = [player]() {
+		QMediaPlayer::MediaStatus s = player->mediaStatus();
+		return s == QMediaPlayer::BufferedMedia || s == QMediaPlayer::InvalidMedia;
+	};
+	if (!player || settled()) return;
+	QEventLoop loop;
+	QObject::connect(player, &QMediaPlayer::mediaStatusChanged, &loop, [&]() { if (settled()) loop.quit(); });
+	QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+	loop.exec();
+}
+
+long Bench::find(MediaClass kind, long after) {
+	for (size_t ii = 1; ii <= view.files.size(); ii ++) {
+		size_t i = (after + ii) % view.files.size();
+		if (view.files.info(i).kind == kind) return i;
+	}
+	return 0;
+}
+
+int main(int argn, char** argv) {
+	// Nothing here needs a display
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	// Keep the thumbnail and index caches out of the user's, and cold on every run
+	QTemporaryDir scratch;
+	qputenv("XDG_CACHE_HOME", QString(scratch.path()+"/cache").toLocal8Bit());
+
+	QApplication a(argn, argv);
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Headless benchmarks for PicoView");
+	parser.addHelpOption();
+	parser.addOption({"sizes", "Comma separated corpus sizes.", "sizes", "100,1000,10000"});
+	parser.addOption({"iterations", "Samples per benchmark.", "n", "5"});
+	parser.addOption({"output", "Write the JSON report to {file} instead of stdout.", "file"});
+	parser.addOption({"corpus", "Generate the corpus under {dir} and keep it.", "dir"});
+	parser.process(a);
+
+	fs::path root = parser.isSet("corpus") ? fs::path(parser.value("corpus").toStdString()) : fs::path(scratch.path().toStdString()) / "corpus";
+	int iterations = std::max(1, parser.value("iterations").toInt());
+
+	QPalette palette;
+	PicoView w(palette);
+	w.resize(1600, 1000);
+	w.show();
+
+	Bench bench(w, iterations);
+	for (const auto &s : parser.value("sizes").split(',', QString::SkipEmptyParts)) {
+		size_t n = s.toULong();
+		if (n == 0) continue;
+		fs::path dir = root / std::to_string(n);
+		if (!fs::exists(dir)) {
+			fprintf(stderr, "Generating %zu files in %s\n", n, dir.c_str());
+			Bench::corpus(dir, n);
+		}
+		bench.run(fs::canonical(dir), n);
+	}
+
+	QJsonObject report;
+	report["benchmark"] = "picoview";
+	report["qt"] = qVersion();
+	report["platform"] = QGuiApplication::platformName();
+	report["kernel"] = scale::kernel();
+	report["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+	report["iterations"] = iterations;
+	report["results"] = bench.results;
+	QByteArray json = QJsonDocument(report).toJson();
+
+	if (parser.isSet("output")) {
+		write(fs::path(parser.value("output").toStdString()), json);
+	}
+	else fwrite(json.constData(), 1, json.size(), stdout);
+	return 0;
+}
@@ -0,0 +1,6 @@
+TEMPLATE = app
+TARGET = picoview_bench
+
+include(../picoview.pri)
+
+SOURCES += bench.c++
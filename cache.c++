@@ -0,0 +1,113 @@
+/*
+ * cache.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Memory-budgeted LRU cache of decoded images for PicoView
+ * minimal image viewer
+ *
+ */
+
+#include "cache.h"
+#include "scale.h"
+
+ImageCache::ImageCache(size_t budget) : _budget(budget) {
+	// Read-ahead and history are the first thing given up when memory runs short
+	client = Governor::instance().enroll("cache", 0, [this](size_t n) { return shed(n); });
+}
+ImageCache::~ImageCache() {
+	Governor::instance().leave(client);
+}
+
+bool ImageCache::find(const fs::path &f, const QSize &target, Decoded &d, bool shrink) {
+	std::string k = key(f);
+	QSize want;
+	{
+		QMutexLocker lock(&mutex);
+		auto found = entries.find(k);
+		if (found == entries.end()) return false;
+
+		// Too small for the current target, a fresh decode is needed
+		const Decoded &cached = found->second->d;
+		want = fitted(cached.native, target);
+		if (cached.image.width() < want.width() || cached.image.height() < want.height()) return false;
+
+		lru.splice(lru.begin(), lru, found->second);
+		d = cached;
+	}
+
+	// Shared with the entry, so shrinking it needs no lock and holds up no one else's lookups
+	if (shrink && d.image.size() != want) d.image = scale::downscale(d.image, want);
+	return true;
+}
+bool ImageCache::contains(const fs::path &f, const QSize &target) {
+	std::string k = key(f);
+	QMutexLocker lock(&mutex);
+	auto found = entries.find(k);
+	if (found == entries.end()) return false;
+	QSize want = fitted(found->second->d.native, target);
+	return found->second->d.image.width() >= want.width() && found->second->d.image.height() >= want.height();
+}
+
+void ImageCache::insert(const Decoded &d) {
+	if (d.image.isNull()) return;
+	std::string k = key(d.file);
+	size_t bytes = d.image.byteCount();
+	if (bytes > _budget) return;
+
+	QMutexLocker lock(&mutex);
+	auto found = entries.find(k);
+	if (found != entries.end()) {
+		_used -= found->second->bytes;
+		lru.erase(found->second);
+		entries.erase(found);
+	}
+	lru.push_front({k, d, bytes});
+	entries[k] = lru.begin();
+	_used += bytes;
+	evict();
+}
+
+size_t ImageCache::shed(size_t n) {
+	QMutexLocker lock(&mutex);
+	size_t freed = 0;
+	while (freed < n && !lru.empty()) {
+		freed += lru.back().bytes;
+		entries.erase(lru.back().key);
+		lru.pop_back();
+	}
+	_used -= freed;
+	Governor::instance().report(client, _used);
+	return freed;
+}
+
+void ImageCache::setBudget(size_t b) {
+	QMutexLocker lock(&mutex);
+	_budget = b;
+	evict();
+}
+
+QSize ImageCache::fitted(const QSize &native, const QSize &target) {
+	if (!target.isValid()) return native;
+	if (native.height() > target.height() || native.width() > target.width()) {
+		return native.scaled(target, Qt::KeepAspectRatio);
+	}
+	return native;
+}
+
+std::string ImageCache::key(const fs::path &f) {
+	// Keying on mtime means a file rewritten in place is never served stale
+	std::error_code ec;
+	auto t = fs::last_write_time(f, ec);
+	return f.string()+'\0'+(ec ? std::string() : std::to_string(t.time_since_epoch().count()));
+}
+
+void ImageCache::evict() {
+	while (_used > _budget && !lru.empty()) {
+		_used -= lru.back().bytes;
+		entries.erase(lru.back().key);
+		lru.pop_back();
+	}
+	Governor::instance().report(client, _used);
+}
@@ -0,0 +1,63 @@
+/*
+ * cache.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Memory-budgeted LRU cache of decoded images for PicoView
+ * minimal image viewer, keyed by path and modification time
+ *
+ */
+
+#pragma once
+
+// std
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// Qt
+#include <QMutex>
+
+#include "governor.h"
+#include "loader.h"
+
+class ImageCache {
+public:
+	ImageCache(size_t budget = 256 << 20);
+	~ImageCache();
+
+	// Look up {f} and fill {d} if a cached decode at least as large as {target} requires exists.
+	// It's shrunk to fit {target} on the calling thread, unless not to {shrink}
+	bool find(const fs::path &f, const QSize &target, Decoded &d, bool shrink = true);
+	bool contains(const fs::path &f, const QSize &target);
+	void insert(const Decoded &d);
+
+	void setBudget(size_t b);
+	size_t budget() const { return _budget; }
+	size_t used() const { return _used; }
+
+	// Drop least recently used entries until {n} bytes are freed, the [Governor]'s eviction hook
+	size_t shed(size_t n);
+
+	// The size [Loader::decode] produces for a {native} source fit into {target},
+	// an invalid {target} means native resolution
+	static QSize fitted(const QSize &native, const QSize &target);
+
+private:
+	struct Entry {
+		std::string key;
+		Decoded d;
+		size_t bytes;
+	};
+
+	static std::string key(const fs::path &f);
+	void evict();
+
+	QMutex mutex;
+	std::list<Entry> lru;               // Most recently used at the front
+	std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+	size_t _budget;
+	size_t _used = 0;
+	Governor::Client* client;
+};
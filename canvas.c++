@@ -0,0 +1,471 @@
+/*
+ * canvas.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Zoom and pan canvas for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Qt
+#include <QDir>
+#include <QImageReader>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QRunnable>
+#include <QStandardPaths>
+#include <QThread>
+#include <QWheelEvent>
+
+// POSIX
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "canvas.h"
+#include "scale.h"
+#include "trace.h"
+
+// Unlinked file under the cache dir that a whole-level decode is cut into, tile by tile, so tiles
+// dropped from memory are read back rather than decoded again. Tile (x, y) of a level is in slot
+// y * columns + x, rows of tile_size * 4 bytes
+struct TileSpill {
+	TileSpill() {
+		QString root = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+		QDir().mkpath(root);
+		QByteArray name = (root+"/tiles-XXXXXX").toLocal8Bit();
+		fd = mkstemp(name.data());
+		if (fd >= 0) unlink(name.constData());
+	}
+	~TileSpill() {
+		if (fd >= 0) ::close(fd);
+	}
+
+	static size_t slot(int columns, int x, int y) {
+		return (size_t(y) * columns + x) * PicoCanvas::tile_size * PicoCanvas::tile_size * 4;
+	}
+
+	int fd;
+};
+
+// Size of the whole image at {level}, and the part of it tile ({x}, {y}) covers
+static QSize levelSize(const QSize &native, int level) {
+	const int f = 1 << level;
+	return QSize((native.width() + f - 1) / f, (native.height() + f - 1) / f);
+}
+static QRect levelTile(const QSize &size, int x, int y) {
+	const int T = PicoCanvas::tile_size;
+	return QRect(x * T, y * T, T, T) & QRect(QPoint(0, 0), size);
+}
+
+class TileTask : public QRunnable {
+public:
+	enum Mode {
+		Clip,                           // Decode the tile's region
+		Whole,                          // Decode the whole level into [spill]
+		Spilled                         // Read the tile back from [spill]
+	};
+
+	TileTask(PicoCanvas* _canvas, int _generation, const fs::path &_file, const QSize &_native, int _level, int _tx, int _ty, Mode _mode, std::shared_ptr<TileSpill> _spill = nullptr) :
+		canvas(_canvas), generation(_generation), file(_file), native(_native), level(_level), tx(_tx), ty(_ty), mode(_mode), spill(_spill) {}
+
+	void run() override {
+		if (!canvas->isCurrent(generation)) return;
+
+		const int T = PicoCanvas::tile_size;
+		const int f = 1 << level;
+		QSize size = levelSize(native, level);
+		int columns = (size.width() + T - 1) / T;
+
+		if (mode == Clip) {
+			// Codec decodes just the region, at the level's resolution
+			QImageReader reader(QString::fromStdString(file.string()));
+			QRect r = QRect(tx * T * f, ty * T * f, T * f, T * f) & QRect(QPoint(0, 0), native);
+			reader.setClipRect(r);
+			reader.setScaledSize(QSize((r.width() + f - 1) / f, (r.height() + f - 1) / f));
+			QImage tile;
+			if (reader.read(&tile)) emit canvas->tileDecoded(generation, level, tx, ty, tile);
+			return;
+		}
+
+		if (mode == Spilled) {
+			QRect r = levelTile(size, tx, ty);
+			QImage tile(r.size(), QImage::Format_ARGB32_Premultiplied);
+			size_t at = TileSpill::slot(columns, tx, ty);
+			for (int y = 0; y < r.height(); y ++) {
+				size_t n = size_t(r.width()) * 4;
+				if (pread(spill->fd, tile.scanLine(y), n, at + size_t(y) * T * 4) != ssize_t(n)) return;
+			}
+			emit canvas->tileDecoded(generation, level, tx, ty, tile);
+			return;
+		}
+
+		// No region decoding, decode the whole level once and cut it into [spill]. Exif rotated
+		// images come this way too, [native] is upright and the scaled size is set before rotating
+		QImageReader reader(QString::fromStdString(file.string()));
+		reader.setAutoTransform(true);
+		bool turned = reader.transformation() & QImageIOHandler::TransformationRotate90;
+		if (reader.supportsOption(QImageIOHandler::ScaledSize)) reader.setScaledSize(turned ? size.transposed() : size);
+		QImage whole;
+		bool ok = reader.read(&whole);
+		if (ok && whole.size() != size) whole = scale::downscale(whole, size);
+		if (ok) whole = whole.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+		for (int y = 0; ok && y * T < size.height(); y ++) {
+			for (int x = 0; ok && x * T < size.width(); x ++) {
+				if (!canvas->isCurrent(generation)) return;
+				QRect r = levelTile(size, x, y);
+				size_t at = TileSpill::slot(columns, x, y);
+				for (int row = 0; ok && row < r.height(); row ++) {
+					size_t n = size_t(r.width()) * 4;
+					ok = pwrite(spill->fd, whole.constScanLine(r.y() + row) + r.x() * 4, n, at + size_t(row) * T * 4) == ssize_t(n);
+				}
+			}
+		}
+		emit canvas->levelDecoded(generation, level, ok);
+	}
+
+private:
+	PicoCanvas* canvas;
+	int generation;
+	fs::path file;
+	QSize native;
+	int level;
+	int tx;                             // Unused for whole-level decodes
+	int ty;
+	Mode mode;
+	std::shared_ptr<TileSpill> spill;
+};
+
+PicoCanvas::PicoCanvas(QWidget* parent) : QWidget(parent), generation(0) {
+	pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+	connect(this, &PicoCanvas::tileDecoded, this, &PicoCanvas::tileReady, Qt::QueuedConnection);
+	connect(this, &PicoCanvas::levelDecoded, this, &PicoCanvas::levelReady, Qt::QueuedConnection);
+
+	// Tiles are given up after the decode cache, the image on screen never
+	client = Governor::instance().enroll("canvas", 1, [this](size_t n) { return shed(n); });
+}
+PicoCanvas::~PicoCanvas() {
+	generation = -1;
+	pool.clear();
+	pool.waitForDone();
+	Governor::instance().leave(client);
+}
+
+void PicoCanvas::setImage(const QImage &image, const QSize &_native, const fs::path &_file) {
+	if (_file != file || _native != native) {
+		file = _file;
+		native = _native;
+		clearTiles();
+		fit = true;
+		center = QPointF(native.width() / 2.0, native.height() / 2.0);
+	}
+	source = image;
+	rescale(Qt::SmoothTransformation);
+	update();
+}
+
+void PicoCanvas::setFrame(const QImage &frame) {
+	if (!file.empty() || frame.size() != native) {
+		file = fs::path();
+		native = frame.size();
+		clearTiles();
+		clampCenter();
+	}
+	source = frame;
+	shown = QImage();
+	if (fit) rescale(Qt::SmoothTransformation);
+	account();
+	update();
+}
+
+void PicoCanvas::rescale(Qt::TransformationMode mode) {
+	if (source.isNull()) {
+		shown = QImage();
+		account();
+		return;
+	}
+
+	// Drawn as an image rather than converted to a pixmap, so a [source] decoded to fit (the usual
+	// case) is shared rather than copied. The raster engine draws either at the same speed
+	QSize target = ImageCache::fitted(native, size());
+	shown = QImage();
+	if (target == source.size()) shown = source;
+	else {
+		TRACE_SCOPE("rescale");
+		shown = mode == Qt::SmoothTransformation ? scale::downscale(source, target) : source.scaled(target, Qt::KeepAspectRatio, mode);
+	}
+	account();
+	update();
+}
+
+// Zoom
+void PicoCanvas::zoomIn() {
+	zoomAround(effectiveScale() * 1.25, rect().center());
+}
+void PicoCanvas::zoomOut() {
+	zoomAround(effectiveScale() / 1.25, rect().center());
+}
+void PicoCanvas::zoomFit() {
+	fit = true;
+	center = QPointF(native.width() / 2.0, native.height() / 2.0);
+	update();
+}
+void PicoCanvas::zoomActual() {
+	zoomAround(1.0, rect().center());
+}
+
+double PicoCanvas::fitScale() const {
+	if (native.isEmpty()) return 1;
+	return (double)ImageCache::fitted(native, size()).width() / native.width();
+}
+
+void PicoCanvas::zoomAround(double s, const QPointF &anchor) {
+	if (native.isEmpty()) return;
+	if (s <= fitScale()) {
+		zoomFit();
+		return;
+	}
+	s = std::min(s, 32.0);
+
+	// Keep the native point under {anchor} fixed
+	QPointF offset = anchor - QPointF(width() / 2.0, height() / 2.0);
+	QPointF p = center + offset / effectiveScale();
+	center = p - offset / s;
+	scale = s;
+	fit = false;
+	clampCenter();
+	update();
+}
+
+void PicoCanvas::clampCenter() {
+	double s = effectiveScale();
+	double hw = width() / 2.0 / s, hh = height() / 2.0 / s;
+	if (native.width() <= 2 * hw) center.setX(native.width() / 2.0);
+	else center.setX(std::max(hw, std::min(native.width() - hw, center.x())));
+	if (native.height() <= 2 * hh) center.setY(native.height() / 2.0);
+	else center.setY(std::max(hh, std::min(native.height() - hh, center.y())));
+}
+
+QPointF PicoCanvas::origin(double s) const {
+	return QPointF(width() / 2.0, height() / 2.0) - center * s;
+}
+
+// Painting
+void PicoCanvas::paintEvent(QPaintEvent* e) {
+	Q_UNUSED(e);
+	pinned = 0;
+	if (source.isNull()) return;
+	TRACE_SCOPE("paint");
+	QPainter p(this);
+
+	if (fit) {
+		if (shown.isNull()) rescale(Qt::FastTransformation);
+		QRect r(QPoint(0, 0), shown.size());
+		r.moveCenter(rect().center());
+		p.drawImage(r, shown);
+		return;
+	}
+
+	double s = scale;
+	QPointF o = origin(s);
+	QRectF visible = QRectF(-o / s, QSizeF(width() / s, height() / s)) & QRectF(QPointF(0, 0), QSizeF(native));
+	if (visible.isEmpty()) return;
+
+	// Draw what [source] has for the visible region, as the final image or as a placeholder for tiles
+	double ss = (double)source.width() / native.width();
+	QRectF from(visible.topLeft() * ss, visible.size() * ss);
+	QRectF to(o + visible.topLeft() * s, visible.size() * s);
+	p.setRenderHint(QPainter::SmoothPixmapTransform, !dragging);
+	p.drawImage(to, source, from);
+
+	if (ss < s * 0.99 && !file.empty()) paintTiles(p, s, visible);
+}
+
+void PicoCanvas::paintTiles(QPainter &p, double s, const QRectF &visible) {
+	// Coarsest level that still has at least one pixel per screen pixel
+	int level = s >= 1 ? 0 : (int)std::floor(std::log2(1.0 / s));
+	const int T = tile_size;
+	const int f = 1 << level;
+	QPointF o = origin(s);
+
+	int x0 = (int)(visible.left() / (T * f)), x1 = (int)((visible.right() - 1e-6) / (T * f));
+	int y0 = (int)(visible.top() / (T * f)), y1 = (int)((visible.bottom() - 1e-6) / (T * f));
+	for (int ty = y0; ty <= y1; ty ++) {
+		for (int tx = x0; tx <= x1; tx ++) {
+			quint64 key = tileKey(level, tx, ty);
+			auto found = tile_index.find(key);
+			if (found == tile_index.end()) {
+				requestTile(level, tx, ty);
+				continue;
+			}
+			tiles.splice(tiles.begin(), tiles, found->second);
+			pinned ++;
+			QRect r = tileRect(level, tx, ty);
+			p.drawImage(QRectF(o + QPointF(r.topLeft()) * s, QSizeF(r.size()) * s), found->second->image);
+		}
+	}
+}
+
+QRect PicoCanvas::tileRect(int level, int tx, int ty) const {
+	const int n = tile_size << level;
+	return QRect(tx * n, ty * n, n, n) & QRect(QPoint(0, 0), native);
+}
+
+// Tiles
+void PicoCanvas::requestTile(int level, int tx, int ty) {
+	// Formats without region decoding are decoded one whole level at a time, as are images
+	// with an Exif orientation, whose regions would be of the image as stored
+	if (clip < 0) {
+		QImageReader reader(QString::fromStdString(file.string()));
+		clip = reader.supportsOption(QImageIOHandler::ClipRect) && reader.transformation() == QImageIOHandler::TransformationNone;
+		scaled = reader.supportsOption(QImageIOHandler::ScaledSize);
+	}
+	if (clip) {
+		quint64 job = tileKey(level, tx, ty);
+		if (in_flight.count(job)) return;
+		in_flight.insert(job);
+		pool.start(new TileTask(this, generation, file, native, level, tx, ty, TileTask::Clip));
+		return;
+	}
+
+	// A level already cut into its spill file is read back a tile at a time, never decoded again
+	if (refused.count(level)) return;
+	if (spills.count(level) && !in_flight.count(tileKey(level, 0xFFFFFF, 0xFFFFFF))) {
+		quint64 job = tileKey(level, tx, ty);
+		if (in_flight.count(job)) return;
+		in_flight.insert(job);
+		pool.start(new TileTask(this, generation, file, native, level, tx, ty, TileTask::Spilled, spills[level]));
+		return;
+	}
+	quint64 job = tileKey(level, 0xFFFFFF, 0xFFFFFF);
+	if (in_flight.count(job)) return;
+
+	// The whole decode is held at once. Rather than fail to allocate (QImage tops out at 2 GB), a
+	// level that doesn't fit under the [Governor]'s cap isn't tried, [source] stands in for it
+	QSize size = levelSize(native, level);
+	size_t whole = scaled ? size_t(size.width()) * size.height() * 4 : size_t(native.width()) * native.height() * 4;
+	std::shared_ptr<TileSpill> spill = std::make_shared<TileSpill>();
+	if (whole > size_t(std::numeric_limits<int>::max()) || whole > Governor::instance().headroom() || spill->fd < 0) {
+		refused.insert(level);
+		return;
+	}
+	spills[level] = spill;
+	in_flight.insert(job);
+	pool.start(new TileTask(this, generation, file, native, level, 0, 0, TileTask::Whole, spill));
+}
+
+void PicoCanvas::tileReady(int g, int level, int tx, int ty, QImage tile) {
+	if (g != generation) return;
+	in_flight.erase(tileKey(level, tx, ty));
+	insertTile(tileKey(level, tx, ty), tile);
+	update();
+}
+
+void PicoCanvas::levelReady(int g, int level, bool ok) {
+	if (g != generation) return;
+	in_flight.erase(tileKey(level, 0xFFFFFF, 0xFFFFFF));
+	if (!ok) {
+		spills.erase(level);
+		refused.insert(level);
+	}
+	update();
+}
+
+void PicoCanvas::insertTile(quint64 key, const QImage &tile) {
+	if (tile_index.count(key)) return;
+	tiles.push_front({key, tile});
+	tile_index[key] = tiles.begin();
+	tile_bytes += tile.byteCount();
+	// Never what the last paint drew, or a level larger than the budget would evict its own tiles
+	while (tile_bytes > tile_budget && tiles.size() > pinned + 1) {
+		tile_bytes -= tiles.back().image.byteCount();
+		tile_index.erase(tiles.back().key);
+		tiles.pop_back();
+	}
+	account();
+}
+
+void PicoCanvas::clearTiles() {
+	++generation;
+	pool.clear();
+	tiles.clear();
+	tile_index.clear();
+	in_flight.clear();
+	spills.clear();
+	refused.clear();
+	tile_bytes = 0;
+	pinned = 0;
+	clip = -1;
+	account();
+}
+
+void PicoCanvas::account() {
+	size_t bytes = tile_bytes + source.byteCount();
+	if (shown.cacheKey() != source.cacheKey()) bytes += shown.byteCount();
+	Governor::instance().report(client, bytes);
+}
+
+size_t PicoCanvas::shed(size_t n) {
+	// Tiles on screen stay, they would only be read straight back
+	size_t freed = 0;
+	while (freed < n && tiles.size() > pinned) {
+		freed += tiles.back().image.byteCount();
+		tile_index.erase(tiles.back().key);
+		tiles.pop_back();
+	}
+	tile_bytes -= freed;
+	account();
+	if (freed) update();
+	return freed;
+}
+
+void PicoCanvas::updateBudget() {
+	// A few screenfuls of tiles, so panning back and forth stays cached
+	size_t screen = size_t(width() / tile_size + 2) * size_t(height() / tile_size + 2) * tile_size * tile_size * 4;
+	tile_budget = std::max(size_t(64) << 20, 3 * screen);
+}
+
+// Events
+void PicoCanvas::resizeEvent(QResizeEvent* e) {
+	QWidget::resizeEvent(e);
+	updateBudget();
+	if (fit) rescale(Qt::FastTransformation);
+	else clampCenter();
+}
+
+void PicoCanvas::wheelEvent(QWheelEvent* e) {
+	if (e->angleDelta().y() == 0) return;
+	zoomAround(effectiveScale() * std::pow(1.25, e->angleDelta().y() / 120.0), e->pos());
+}
+
+void PicoCanvas::mousePressEvent(QMouseEvent* e) {
+	if (e->button() != Qt::LeftButton || fit) return QWidget::mousePressEvent(e);
+	dragging = true;
+	drag = e->pos();
+	setCursor(Qt::ClosedHandCursor);
+}
+void PicoCanvas::mouseMoveEvent(QMouseEvent* e) {
+	if (!dragging) return QWidget::mouseMoveEvent(e);
+	center -= QPointF(e->pos() - drag) / scale;
+	drag = e->pos();
+	clampCenter();
+	update();
+}
+void PicoCanvas::mouseReleaseEvent(QMouseEvent* e) {
+	if (!dragging) return QWidget::mouseReleaseEvent(e);
+	dragging = false;
+	unsetCursor();
+	update();
+}
+void PicoCanvas::mouseDoubleClickEvent(QMouseEvent* e) {
+	// Toggle between fit and native resolution, centred on the cursor
+	if (fit) zoomAround(1.0, e->pos());
+	else zoomFit();
+}
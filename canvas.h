@@ -0,0 +1,129 @@
+/*
+ * canvas.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Zoom and pan canvas for PicoView minimal image viewer. Fit-to-window
+ * uses the decoded image handed over by [Loader], zooming past its
+ * resolution renders from a lazily decoded multi-resolution tile pyramid
+ *
+ */
+
+#pragma once
+
+// std
+#include <atomic>
+#include <experimental/filesystem>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+// Qt
+#include <QImage>
+#include <QPointF>
+#include <QThreadPool>
+#include <QWidget>
+
+#include "governor.h"
+
+namespace fs = std::experimental::filesystem;
+
+struct TileSpill;
+
+class PicoCanvas : public QWidget {
+	Q_OBJECT
+
+public:
+	PicoCanvas(QWidget* parent = Q_NULLPTR);
+	~PicoCanvas();
+
+	// Show {image}, a whole-image decode of {file} at any resolution up to {native}.
+	// A new {file} resets the zoom, the same {file} keeps it (e.g. a larger decode)
+	void setImage(const QImage &image, const QSize &native, const fs::path &file);
+
+	// Show an animation frame, already scaled, no tiles are used
+	void setFrame(const QImage &frame);
+
+	// Rebuild the fit-to-window pixmap from [source]
+	void rescale(Qt::TransformationMode mode);
+
+	const QImage &image() const { return source; }
+	const fs::path &path() const { return file; }
+	bool isFit() const { return fit; }
+	bool isCurrent(int g) const { return g == generation.load(); }
+
+	static const int tile_size = 256;
+
+public slots:
+	void zoomIn();
+	void zoomOut();
+	void zoomFit();
+	void zoomActual();
+
+signals:
+	// Emitted from the tile workers, delivered queued to [tileReady]
+	void tileDecoded(int generation, int level, int tx, int ty, QImage tile);
+	void levelDecoded(int generation, int level, bool ok);  // A whole-level decode is in its spill file
+
+protected:
+	void paintEvent(QPaintEvent* e) override;
+	void resizeEvent(QResizeEvent* e) override;
+	void wheelEvent(QWheelEvent* e) override;
+	void mousePressEvent(QMouseEvent* e) override;
+	void mouseMoveEvent(QMouseEvent* e) override;
+	void mouseReleaseEvent(QMouseEvent* e) override;
+	void mouseDoubleClickEvent(QMouseEvent* e) override;
+
+private slots:
+	void tileReady(int g, int level, int tx, int ty, QImage tile);
+	void levelReady(int g, int level, bool ok);
+
+private:
+	struct Tile {
+		quint64 key;
+		QImage image;
+	};
+
+	double fitScale() const;
+	double effectiveScale() const { return fit ? fitScale() : scale; }
+	void zoomAround(double s, const QPointF &anchor);
+	void clampCenter();
+	QPointF origin(double s) const;     // Widget position of native (0, 0) at scale {s}
+	QRect tileRect(int level, int tx, int ty) const;
+	void paintTiles(QPainter &p, double s, const QRectF &visible);
+	void requestTile(int level, int tx, int ty);
+	void insertTile(quint64 key, const QImage &tile);
+	void clearTiles();
+	void updateBudget();
+	void account();                     // Report what's held to the [Governor]
+	size_t shed(size_t n);              // Eviction hook, drops least recently used tiles
+
+	static quint64 tileKey(int level, int tx, int ty) { return (quint64(level) << 48) | (quint64(ty) << 24) | quint64(tx); }
+
+	fs::path file;
+	QImage source;                      // Whole-image decode, possibly reduced
+	QImage shown;                       // [source] fit to the widget, [source] itself when that already fits
+	QSize native;
+	bool fit = true;
+	double scale = 1;                   // Screen pixels per native pixel when not [fit]
+	QPointF center;                     // Native coordinate shown at the middle of the widget
+	QPoint drag;
+	bool dragging = false;
+
+	// Tiles of the pyramid for [file], level L is downsampled by 2^L
+	std::list<Tile> tiles;              // Most recently used at the front
+	std::unordered_map<quint64, std::list<Tile>::iterator> tile_index;
+	std::unordered_set<quint64> in_flight;
+	std::unordered_map<int, std::shared_ptr<TileSpill>> spills;    // Levels decoded whole, by level
+	std::unordered_set<int> refused;    // Levels too large to decode whole, drawn from [source]
+	size_t tile_bytes = 0;
+	size_t tile_budget = 64 << 20;      // Grows with the widget, never with the image
+	size_t pinned = 0;                  // Tiles the last paint drew, at the front of [tiles]
+	int clip = -1;                      // Whether the codec for [file] decodes regions, -1 if unknown
+	bool scaled = false;                // Whether it decodes at reduced size
+	Governor::Client* client;
+	std::atomic<int> generation;
+	QThreadPool pool;
+};
@@ -0,0 +1,152 @@
+/*
+ * exif.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Exif reading for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <cstdint>
+#include <cstring>
+
+// Qt
+#include <QTransform>
+
+#include "exif.h"
+#include "mapped.h"
+
+namespace exif {
+
+namespace {
+
+// Bounds-checked reads from a TIFF structure of either byte order
+struct Tiff {
+	const unsigned char* data;
+	size_t n;
+	bool little;
+
+	uint32_t u16(size_t at) const {
+		if (at + 2 > n) return 0;
+		const unsigned char* p = data + at;
+		return little ? p[0] | (p[1] << 8) : (p[0] << 8) | p[1];
+	}
+	uint32_t u32(size_t at) const {
+		if (at + 4 > n) return 0;
+		const unsigned char* p = data + at;
+		return little ? p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24) :
+			(uint32_t(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	}
+
+	// Scalar value of the entry at {at}, SHORT or LONG
+	uint32_t value(size_t at) const { return u16(at + 2) == 3 ? u16(at + 8) : u32(at + 8); }
+};
+
+const int max_ifds = 32;                // Bounds the walk through a damaged or hostile file
+
+void consider(const Tiff &t, size_t base, uint32_t offset, uint32_t length, Info &info) {
+	// Only ordinary JPEGs, starting with SOI, count
+	if (length < 4 || length <= info.preview_length || offset == 0 || size_t(offset) + length > t.n) return;
+	if (t.data[offset] != 0xFF || t.data[offset + 1] != 0xD8) return;
+	info.preview_offset = base + offset;
+	info.preview_length = length;
+}
+
+void walk(const Tiff &t, size_t base, uint32_t ifd, bool first, int &budget, Info &info) {
+	while (ifd && budget-- > 0 && size_t(ifd) + 2 <= t.n) {
+		uint32_t count = t.u16(ifd);
+		uint32_t jpeg = 0, jpeg_length = 0, strip = 0, strip_length = 0, compression = 0, strips = 0;
+		for (uint32_t ii = 0; ii < count; ii ++) {
+			size_t e = ifd + 2 + size_t(ii) * 12;
+			if (e + 12 > t.n) break;
+			switch (t.u16(e)) {
+				case 0x0103: compression = t.value(e); break;
+				case 0x0111: strip = t.value(e); strips = t.u32(e + 4); break;
+				case 0x0117: strip_length = t.value(e); break;
+				case 0x0112: if (first) info.orientation = int(t.value(e)); break;
+				case 0x0201: jpeg = t.value(e); break;
+				case 0x0202: jpeg_length = t.value(e); break;
+				case 0x014A: {
+					// SubIFDs, where raws tend to keep their larger previews
+					uint32_t subs = t.u32(e + 4);
+					uint32_t at = subs == 1 ? uint32_t(e + 8) : t.u32(e + 8);
+					for (uint32_t jj = 0; jj < subs && jj < 8; jj ++) walk(t, base, t.u32(at + jj * 4), false, budget, info);
+					break;
+				}
+			}
+		}
+		consider(t, base, jpeg, jpeg_length, info);
+		if (compression == 6 && strips == 1) consider(t, base, strip, strip_length, info);
+		ifd = t.u32(ifd + 2 + size_t(count) * 12);
+		first = false;
+	}
+}
+
+bool tiff(const unsigned char* data, size_t n, size_t base, Info &info) {
+	if (n < 8) return false;
+	bool little = data[0] == 'I' && data[1] == 'I';
+	if (!little && !(data[0] == 'M' && data[1] == 'M')) return false;
+	Tiff t = {data, n, little};
+	if (t.u16(2) != 42) return false;
+
+	int budget = max_ifds;
+	walk(t, base, t.u32(4), true, budget, info);
+	if (info.orientation < 1 || info.orientation > 8) info.orientation = 1;
+	return true;
+}
+
+}
+
+bool parse(const unsigned char* data, size_t n, Info &info) {
+	info = Info();
+	if (n < 4) return false;
+	if (data[0] != 0xFF || data[1] != 0xD8) return tiff(data, n, 0, info);
+
+	// JPEG: the Exif APP1 segment comes before the image data
+	size_t p = 2;
+	while (p + 4 <= n && data[p] == 0xFF) {
+		unsigned char marker = data[p + 1];
+		if (marker == 0xD8 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+			p += 2;
+			continue;
+		}
+		if (marker == 0xDA || marker == 0xD9) break;
+		size_t length = (data[p + 2] << 8) | data[p + 3];
+		if (length < 2 || p + 2 + length > n) break;
+		if (marker == 0xE1 && length >= 8 && memcmp(data + p + 4, "Exif\0\0", 6) == 0) {
+			size_t base = p + 10;
+			return tiff(data + base, length - 8, base, info);
+		}
+		p += 2 + length;
+	}
+	return false;
+}
+
+QImage orient(const QImage &image, int orientation) {
+	switch (orientation) {
+		case 2: return image.mirrored(true, false);
+		case 3: return image.transformed(QTransform().rotate(180));
+		case 4: return image.mirrored(false, true);
+		case 5: return image.transformed(QTransform().rotate(90)).mirrored(true, false);
+		case 6: return image.transformed(QTransform().rotate(90));
+		case 7: return image.transformed(QTransform().rotate(90)).mirrored(false, true);
+		case 8: return image.transformed(QTransform().rotate(270));
+		default: return image;
+	}
+}
+
+QImage preview(const fs::path &f) {
+	// Only the header and the preview are read, not the tens of megabytes of raw data around them
+	MappedFile mapped(f, nullptr, MappedFile::Random);
+	Info info;
+	if (!mapped.isOpen() || !parse(mapped.bytes(), mapped.size(), info) || !info.preview_length) return QImage();
+	mapped.advise(info.preview_offset, info.preview_length);
+
+	// Embedded previews are stored as shot, the orientation tag applies to them too
+	QImage image = QImage::fromData(mapped.bytes() + info.preview_offset, int(info.preview_length), "JPEG");
+	return image.isNull() ? image : orient(image, info.orientation);
+}
+
+}
@@ -0,0 +1,42 @@
+/*
+ * exif.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Exif reading for PicoView minimal image viewer, finds the
+ * orientation and the embedded JPEG preview of camera files
+ * (JPEG, and TIFF-based raws) without decoding the image
+ *
+ */
+
+#pragma once
+
+// std
+#include <cstddef>
+#include <experimental/filesystem>
+
+// Qt
+#include <QImage>
+
+namespace fs = std::experimental::filesystem;
+
+namespace exif {
+
+struct Info {
+	int orientation = 1;                // As in the TIFF tag, 1 is upright
+	size_t preview_offset = 0;          // Largest embedded JPEG in the file, length 0 if there's none
+	size_t preview_length = 0;
+};
+
+// Parse the Exif block of a JPEG, or the IFDs of a TIFF-based raw, out of the {n} bytes
+// of a whole file. False if neither is there
+bool parse(const unsigned char* data, size_t n, Info &info);
+
+// Turn {image} upright according to the Exif {orientation}
+QImage orient(const QImage &image, int orientation);
+
+// Largest embedded preview of {f}, decoded and upright. Null if it has none
+QImage preview(const fs::path &f);
+
+}
@@ -0,0 +1,144 @@
+/*
+ * filelist.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Per-file metadata table for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <algorithm>
+#include <iterator>
+
+// POSIX
+#include <sys/stat.h>
+
+#include "filelist.h"
+#include "trace.h"
+
+FileEntry FileEntry::stat(const fs::path &p, const std::string &ext) {
+	FileEntry e;
+	e.path = p;
+	e.ext = ext;
+	struct stat st;
+	if (::stat(p.c_str(), &st) == 0) {
+		e.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+		e.size = st.st_size;
+	}
+	return e;
+}
+
+void FileList::clear() {
+	entries.clear();
+	index.clear();
+	stale = 0;
+	_revision ++;
+}
+
+void FileList::push_back(FileEntry e) {
+	e.key = sortKey(e, _mode);
+	if (stale == entries.size()) stale ++;
+	index[e.path.string()] = entries.size();
+	entries.push_back(std::move(e));
+	_revision ++;
+}
+
+void FileList::erase(size_t i) {
+	index.erase(entries[i].path.string());
+	entries.erase(entries.begin() + i);
+	reindex(i);
+}
+
+size_t FileList::insert(FileEntry e) {
+	remove(e.path);
+	e.key = sortKey(e, _mode);
+	auto pos = std::upper_bound(entries.begin(), entries.end(), e, [](const FileEntry &l, const FileEntry &r) { return l.key < r.key; });
+	size_t i = pos - entries.begin();
+	entries.insert(pos, std::move(e));
+	reindex(i);
+	return i;
+}
+
+long FileList::remove(const fs::path &p) {
+	long i = indexOf(p);
+	if (i >= 0) erase(i);
+	return i;
+}
+
+size_t FileList::refresh(size_t i) {
+	FileEntry e = FileEntry::stat(entries[i].path, entries[i].ext);
+	if (e.mtime == entries[i].mtime && e.size == entries[i].size) return i;
+	return insert(std::move(e));
+}
+
+void FileList::merge(std::vector<FileEntry> batch) {
+	auto less = [](const FileEntry &l, const FileEntry &r) { return l.key < r.key; };
+	batch.erase(std::remove_if(batch.begin(), batch.end(), [this](const FileEntry &e) { return indexOf(e.path) >= 0; }), batch.end());
+	for (auto &e : batch) e.key = sortKey(e, _mode);
+	std::sort(batch.begin(), batch.end(), less);
+
+	size_t mid = entries.size();
+	entries.insert(entries.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+	std::inplace_merge(entries.begin(), entries.begin() + mid, entries.end(), less);
+	reindex();
+}
+
+void FileList::assign(std::vector<FileEntry> sorted, SortMode m) {
+	_mode = m;
+	entries = std::move(sorted);
+	for (auto &e : entries) e.key = sortKey(e, m);
+	index.clear();
+	stale = 0;
+	reindex();
+}
+
+void FileList::sort(SortMode m) {
+	if (m != _mode) {
+		_mode = m;
+		for (auto &e : entries) e.key = sortKey(e, m);
+	}
+	std::sort(entries.begin(), entries.end(), [](const FileEntry &l, const FileEntry &r) { return l.key < r.key; });
+	reindex();
+}
+
+long FileList::indexOf(const fs::path &p) const {
+	for (; stale < entries.size(); stale ++) index[entries[stale].path.string()] = stale;
+	auto found = index.find(p.string());
+	return found == index.end() ? -1 : (long)found->second;
+}
+
+const MediaInfo &FileList::info(size_t i) {
+	FileEntry &e = entries[i];
+	if (!e.probed) {
+		TRACE_SCOPE("probe");
+		e.media = media::probe(e.path);
+		e.probed = true;
+		_probes ++;
+	}
+	return e.media;
+}
+
+std::string FileList::sortKey(const FileEntry &e, SortMode m) {
+	switch (m) {
+		case SortMode::modified: {
+			// Big-endian with the sign bit flipped so byte order matches numeric order, ties broken by name
+			std::string k(8, '\0');
+			uint64_t t = uint64_t(e.mtime) ^ (uint64_t(1) << 63);
+			for (int ii = 0; ii < 8; ii ++) k[ii] = char(t >> (56 - 8 * ii));
+			return k + e.path.string();
+		}
+		case SortMode::type:
+			return e.ext + '\0' + e.path.filename().string();
+
+		case SortMode::name:
+		default:
+			return e.path.string();
+	}
+}
+
+void FileList::reindex(size_t from) {
+	_revision ++;
+	stale = std::min(stale, from);
+}
@@ -0,0 +1,95 @@
+/*
+ * filelist.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Per-file metadata table for PicoView minimal image viewer, stat-ed
+ * once when the directory is listed so sorting never touches the disk
+ *
+ */
+
+#pragma once
+
+// std
+#include <cstdint>
+#include <experimental/filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "media.h"
+
+namespace fs = std::experimental::filesystem;
+
+enum SortMode { name, modified, type };
+
+struct FileEntry {
+	fs::path path;
+	std::string ext;                    // Lower case, including the leading '.'
+	int64_t mtime = 0;                  // Nanoseconds since the epoch
+	uintmax_t size = 0;
+	std::string key;                    // Sort key for the list's current [SortMode]
+	MediaInfo media;                    // Filled in by [FileList::info] the first time it's needed
+	bool probed = false;
+
+	// Builds the entry with a single stat of {p}
+	static FileEntry stat(const fs::path &p, const std::string &ext);
+};
+
+class FileList {
+public:
+	void clear();
+	void push_back(FileEntry e);
+	void erase(size_t i);
+
+	// Keep the list sorted while applying single changes, both return the affected position
+	size_t insert(FileEntry e);
+	long remove(const fs::path &p);
+
+	// Stat entry {i} again, and if it was rewritten since it was listed update it and move it to
+	// where it now sorts. Returns its position
+	size_t refresh(size_t i);
+
+	// Sort {batch} and merge it into the (sorted) list, skipping paths already present
+	void merge(std::vector<FileEntry> batch);
+
+	// Take over {sorted}, already in {m} order, without sorting it again
+	void assign(std::vector<FileEntry> sorted, SortMode m);
+
+	// Sort by {m}, comparing only the precomputed [FileEntry::key]
+	void sort(SortMode m);
+	SortMode mode() const { return _mode; }
+
+	// Bumped by every change to the membership or order of the list
+	uint64_t revision() const { return _revision; }
+
+	// Bumped every time [info] has to sniff a file
+	uint64_t probes() const { return _probes; }
+
+	// Position of {p} in the list, -1 if it isn't there
+	long indexOf(const fs::path &p) const;
+
+	// Media class and dimensions of entry {i}, sniffed from its header once and cached
+	const MediaInfo &info(size_t i);
+
+	const FileEntry &operator[](size_t i) const { return entries[i]; }
+	size_t size() const { return entries.size(); }
+	bool empty() const { return entries.empty(); }
+	std::vector<FileEntry>::const_iterator begin() const { return entries.begin(); }
+	std::vector<FileEntry>::const_iterator end() const { return entries.end(); }
+
+	static std::string sortKey(const FileEntry &e, SortMode m);
+
+private:
+	// Positions from {from} on have moved. [index] catches up lazily in [indexOf], so a run of
+	// erases (deleting one file after another) doesn't rehash the tail of the list every time
+	void reindex(size_t from = 0);
+
+	std::vector<FileEntry> entries;
+	mutable std::unordered_map<std::string, size_t> index;
+	mutable size_t stale = 0;           // [index] is behind for positions from here on
+	SortMode _mode = name;
+	uint64_t _revision = 0;
+	uint64_t _probes = 0;
+};
@@ -0,0 +1,103 @@
+/*
+ * governor.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Process-wide memory accounting for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+
+// Qt
+#include <QCoreApplication>
+#include <QThread>
+
+// POSIX
+#include <unistd.h>
+
+#include "governor.h"
+
+Governor::Governor() {
+	// A quarter of physical memory unless PICOVIEW_MEMORY_MB says otherwise
+	size_t physical = size_t(sysconf(_SC_PHYS_PAGES)) * size_t(sysconf(_SC_PAGE_SIZE));
+	_cap = physical ? physical / 4 : size_t(1) << 30;
+	if (const char* mb = std::getenv("PICOVIEW_MEMORY_MB")) _cap = size_t(std::atoi(mb)) << 20;
+
+	// Queued [enforce] calls have to land on the GUI thread, wherever this was first used
+	if (QCoreApplication::instance()) moveToThread(QCoreApplication::instance()->thread());
+}
+
+Governor &Governor::instance() {
+	static Governor g;
+	return g;
+}
+
+Governor::Client* Governor::enroll(const std::string &name, int order, Shed shed) {
+	QMutexLocker lock(&mutex);
+	clients.emplace_back(new Client);
+	Client* c = clients.back().get();
+	c->name = name;
+	c->order = order;
+	c->shed = shed;
+	return c;
+}
+
+void Governor::leave(Client* client) {
+	report(client, 0);
+	QMutexLocker lock(&mutex);
+	client->shed = nullptr;
+	client->name.clear();
+}
+
+void Governor::report(Client* client, size_t bytes) {
+	size_t old = client->bytes.exchange(bytes);
+	total += bytes - old;
+	if (total.load() > _cap.load() && !scheduled.exchange(true)) {
+		QMetaObject::invokeMethod(this, "enforce", Qt::QueuedConnection);
+	}
+}
+
+void Governor::setCap(size_t c) {
+	_cap = c;
+	if (!scheduled.exchange(true)) QMetaObject::invokeMethod(this, "enforce", Qt::QueuedConnection);
+}
+
+size_t Governor::headroom() const {
+	size_t t = total.load(), c = _cap.load();
+	return t < c ? c - t : 0;
+}
+
+std::vector<std::pair<std::string, size_t>> Governor::usage() {
+	std::map<std::string, size_t> by_name;
+	{
+		QMutexLocker lock(&mutex);
+		for (const auto &c : clients) {
+			if (!c->name.empty()) by_name[c->name] += c->bytes.load();
+		}
+	}
+	return std::vector<std::pair<std::string, size_t>>(by_name.begin(), by_name.end());
+}
+
+void Governor::enforce() {
+	scheduled = false;
+	std::vector<std::pair<int, Shed>> hooks;
+	{
+		QMutexLocker lock(&mutex);
+		for (const auto &c : clients) {
+			if (c->shed) hooks.push_back({c->order, c->shed});
+		}
+	}
+	std::stable_sort(hooks.begin(), hooks.end(), [](const std::pair<int, Shed> &l, const std::pair<int, Shed> &r) { return l.first < r.first; });
+
+	// Cheapest to lose first, until back under the cap
+	for (const auto &h : hooks) {
+		size_t t = total.load(), c = _cap.load();
+		if (t <= c) break;
+		h.second(t - c);
+	}
+}
@@ -0,0 +1,76 @@
+/*
+ * governor.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Process-wide memory accounting for PicoView minimal image viewer.
+ * Everything that holds decoded pixels reports what it holds, and
+ * once the total passes the cap the governor has the cheapest of them
+ * give memory back through their eviction hooks
+ *
+ */
+
+#pragma once
+
+// std
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Qt
+#include <QMutex>
+#include <QObject>
+
+class Governor : public QObject {
+	Q_OBJECT
+
+public:
+	// Eviction hook, frees about {n} bytes if it can and returns how many it did
+	typedef std::function<size_t(size_t n)> Shed;
+
+	struct Client;
+
+	static Governor &instance();
+
+	// Register a holder of memory. Hooks of lower {order} are asked first, a null {shed}
+	// is only counted. Hooks always run on the GUI thread
+	Client* enroll(const std::string &name, int order, Shed shed = nullptr);
+	void leave(Client* client);
+
+	// Set the bytes {client} holds, from any thread. Images shared between holders
+	// count once for each, so the total errs high
+	void report(Client* client, size_t bytes);
+
+	size_t used() const { return total.load(); }
+	size_t cap() const { return _cap.load(); }
+	void setCap(size_t c);
+
+	// Bytes still free under the cap, 0 once over it
+	size_t headroom() const;
+
+	// Bytes held per client name, for the readout
+	std::vector<std::pair<std::string, size_t>> usage();
+
+	struct Client {
+		std::string name;
+		int order;
+		Shed shed;
+		std::atomic<size_t> bytes{0};
+	};
+
+private slots:
+	void enforce();
+
+private:
+	Governor();
+
+	QMutex mutex;
+	std::vector<std::unique_ptr<Client>> clients;    // Left clients stay, emptied, so no handle dangles
+	std::atomic<size_t> total{0};
+	std::atomic<size_t> _cap;
+	std::atomic<bool> scheduled{false};              // An [enforce] is queued
+};
@@ -0,0 +1,154 @@
+/*
+ * index.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Persistent per-directory index for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// POSIX
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Qt
+#include <QCryptographicHash>
+#include <QDir>
+#include <QStandardPaths>
+
+#include "index.h"
+
+static const char magic[8] = {'P', 'V', 'I', 'N', 'D', 'E', 'X', '1'};
+
+// Host-endian records, the index never leaves the machine that wrote it
+class Writer {
+public:
+	template <typename T>
+	void put(const T &v) { append(&v, sizeof(v)); }
+	void put(const std::string &s) { put(uint32_t(s.size())); append(s.data(), s.size()); }
+	void append(const void* p, size_t n) { buffer.insert(buffer.end(), (const char*)p, (const char*)p + n); }
+
+	std::vector<char> buffer;
+};
+
+class Reader {
+public:
+	Reader(const std::vector<char> &_buffer) : buffer(_buffer) {}
+
+	template <typename T>
+	bool get(T &v) { return take(&v, sizeof(v)); }
+	bool get(std::string &s) {
+		uint32_t n;
+		if (!get(n) || at + n > buffer.size()) return false;
+		s.assign(buffer.data() + at, n);
+		at += n;
+		return true;
+	}
+	bool take(void* p, size_t n) {
+		if (at + n > buffer.size()) return false;
+		memcpy(p, buffer.data() + at, n);
+		at += n;
+		return true;
+	}
+	size_t remaining() const { return buffer.size() - at; }
+
+private:
+	const std::vector<char> &buffer;
+	size_t at = 0;
+};
+
+bool DirIndex::load(const fs::path &dir, FileList &files, SortMode &mode) {
+	std::unique_ptr<FILE, decltype(&fclose)> file(fopen(location(dir).c_str(), "rb"), fclose);
+	if (!file) return false;
+
+	std::vector<char> buffer;
+	char chunk[1 << 16];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof(chunk), file.get())) > 0) buffer.insert(buffer.end(), chunk, chunk + n);
+
+	Reader r(buffer);
+	char m[8];
+	uint32_t _mode;
+	int64_t stamp;
+	uint64_t count;
+	if (!r.take(m, 8) || memcmp(m, magic, 8) || !r.get(_mode) || !r.get(stamp) || !r.get(count)) return false;
+
+	// Anything added, removed or renamed since the save moves the directory's mtime
+	if (stamp != mtime(dir) || _mode > SortMode::type) return false;
+
+	// Every record holds at least its two string lengths, a count that can't fit is of a corrupt
+	// or foreign file, and would otherwise be reserved as is
+	if (count > r.remaining() / (2 * sizeof(uint32_t))) return false;
+
+	std::vector<FileEntry> entries;
+	entries.reserve(count);
+	for (uint64_t ii = 0; ii < count; ii ++) {
+		FileEntry e;
+		std::string name;
+		uint8_t probed, kind;
+		if (!r.get(name) || !r.get(e.ext) || !r.get(e.mtime) || !r.get(e.size) || !r.get(probed) || !r.get(kind) ||
+		    !r.get(e.media.width) || !r.get(e.media.height) || !r.get(e.media.duration) || !r.get(e.media.codec)) return false;
+		e.path = dir / name;
+		e.probed = probed;
+		e.media.kind = MediaClass(kind);
+		entries.push_back(std::move(e));
+	}
+
+	mode = SortMode(_mode);
+	files.assign(std::move(entries), mode);
+	return true;
+}
+
+bool DirIndex::save(const fs::path &dir, const FileList &files) {
+	Writer w;
+	w.append(magic, 8);
+	w.put(uint32_t(files.mode()));
+	w.put(mtime(dir));
+	w.put(uint64_t(files.size()));
+	for (const auto &e : files) {
+		w.put(e.path.filename().string());
+		w.put(e.ext);
+		w.put(e.mtime);
+		w.put(e.size);
+		w.put(uint8_t(e.probed));
+		w.put(uint8_t(e.media.kind));
+		w.put(e.media.width);
+		w.put(e.media.height);
+		w.put(e.media.duration);
+		w.put(e.media.codec);
+	}
+
+	// Written aside and renamed over, so a reader never sees half an index. The name is this
+	// process's own, another instance saving the same directory writes its own file
+	std::string target = location(dir);
+	std::string temp = target+"."+std::to_string(getpid())+".tmp";
+	bool ok;
+	{
+		std::unique_ptr<FILE, decltype(&fclose)> file(fopen(temp.c_str(), "wb"), fclose);
+		ok = file && fwrite(w.buffer.data(), 1, w.buffer.size(), file.get()) == w.buffer.size();
+	}
+	if (ok) ok = rename(temp.c_str(), target.c_str()) == 0;
+	if (!ok) remove(temp.c_str());
+	return ok;
+}
+
+std::string DirIndex::location(const fs::path &dir) {
+	QString root = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)+"/index";
+	QDir().mkpath(root);
+	QByteArray name = QCryptographicHash::hash(QByteArray::fromStdString(dir.string()), QCryptographicHash::Sha1).toHex();
+	return (root+"/"+name+".idx").toStdString();
+}
+
+int64_t DirIndex::mtime(const fs::path &dir) {
+	struct stat st;
+	if (::stat(dir.c_str(), &st) != 0) return -1;
+	return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
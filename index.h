@@ -0,0 +1,38 @@
+/*
+ * index.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Persistent per-directory index for PicoView minimal image viewer.
+ * Stores the listing with its metadata, media classes and sort order
+ * under the user cache dir, so an unchanged directory reopens without
+ * being walked or stat-ed
+ *
+ */
+
+#pragma once
+
+// std
+#include <experimental/filesystem>
+
+#include "filelist.h"
+
+namespace fs = std::experimental::filesystem;
+
+class DirIndex {
+public:
+	// Replace {files} with the stored listing of {dir} if it is still valid, i.e. the
+	// directory's mtime hasn't moved since it was saved. {mode} receives the stored sort order.
+	// A file rewritten in place doesn't move that mtime, so its stored mtime and size (and the
+	// Modified order and thumbnail keys built on them) stay stale until [FileList::refresh]
+	// stats it again as it is shown
+	static bool load(const fs::path &dir, FileList &files, SortMode &mode);
+
+	// Write the listing of {dir}, stamped with the directory's current mtime
+	static bool save(const fs::path &dir, const FileList &files);
+
+private:
+	static std::string location(const fs::path &dir);
+	static int64_t mtime(const fs::path &dir);
+};
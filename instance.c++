@@ -0,0 +1,118 @@
+/*
+ * instance.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Single-instance mode for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+// Qt
+#include <QByteArray>
+#include <QLocalSocket>
+
+// POSIX
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "instance.h"
+
+Instance::Instance(QObject* parent) : QObject(parent) {
+	server = new QLocalServer(this);
+	connect(server, &QLocalServer::newConnection, this, &Instance::accept);
+}
+Instance::~Instance() {
+	server->close();
+}
+
+std::string Instance::address() {
+	const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+	std::string name = "/picoview-"+std::to_string(getuid())+".sock";
+	if (runtime && *runtime) return runtime+name;
+
+	// Without a runtime directory, one of our own under /tmp, where a name anyone can guess would
+	// let another user listen first. Only used if it really is ours and private, not a plant
+	std::string dir = "/tmp/picoview-"+std::to_string(getuid());
+	if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) return std::string();
+	struct stat st;
+	if (lstat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 077)) return std::string();
+	return dir+name;
+}
+
+bool Instance::forward(const std::vector<std::string> &args) {
+	std::string a = address();
+	if (a.empty()) return false;
+	sockaddr_un sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	if (a.size() >= sizeof(sa.sun_path)) return false;
+	memcpy(sa.sun_path, a.c_str(), a.size());
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) return false;
+	if (::connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0) {
+		close(fd);
+		return false;
+	}
+
+	// Arguments are paths the user is opening, they only go to a process of the same user
+	ucred peer;
+	socklen_t len = sizeof(peer);
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &len) != 0 || peer.uid != getuid()) {
+		close(fd);
+		return false;
+	}
+
+	// Arguments separated by NULs, the end of the message is the end of the stream
+	std::string msg;
+	for (const auto &s : args) msg += s+'\0';
+	size_t sent = 0;
+	while (sent < msg.size()) {
+		ssize_t n = write(fd, msg.data() + sent, msg.size() - sent);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			close(fd);
+			return false;
+		}
+		sent += n;
+	}
+	close(fd);
+	return true;
+}
+
+bool Instance::listen() {
+	std::string path = address();
+	if (path.empty()) return false;
+	QString a = QString::fromStdString(path);
+	server->setSocketOptions(QLocalServer::UserAccessOption);
+	if (server->listen(a)) return true;
+	if (server->serverError() != QAbstractSocket::AddressInUseError) return false;
+
+	// Either another instance won the race, or the socket was left behind by one that died
+	if (forward({})) return false;
+	QLocalServer::removeServer(a);
+	return server->listen(a);
+}
+
+void Instance::accept() {
+	// The sender closes once it's written everything, so the message is read whole on disconnect
+	while (QLocalSocket* s = server->nextPendingConnection()) {
+		connect(s, &QLocalSocket::disconnected, s, &QLocalSocket::deleteLater);
+		connect(s, &QLocalSocket::disconnected, this, [this, s]() {
+			QByteArray msg = s->readAll();
+			if (msg.isEmpty()) return;
+			QStringList args;
+			for (const auto &a : msg.split('\0')) args << QString::fromLocal8Bit(a);
+			args.removeLast();
+			emit requested(args);
+		});
+	}
+}
@@ -0,0 +1,51 @@
+/*
+ * instance.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Single-instance mode for PicoView minimal image viewer. A resident
+ * process listens on a local socket, later launches hand it their
+ * arguments and exit before paying for any Qt startup
+ *
+ */
+
+#pragma once
+
+// std
+#include <string>
+#include <vector>
+
+// Qt
+#include <QLocalServer>
+#include <QObject>
+#include <QStringList>
+
+class Instance : public QObject {
+	Q_OBJECT
+
+public:
+	Instance(QObject* parent = Q_NULLPTR);
+	~Instance();
+
+	// Pass {args} to the resident instance. False if there isn't one. Plain POSIX,
+	// so it can run before the QApplication is created
+	static bool forward(const std::vector<std::string> &args);
+
+	// Become the resident instance, replacing the socket of one that died. False
+	// if another instance is already listening
+	bool listen();
+
+	// Socket path, per user, in the runtime directory or a private one under /tmp. Empty if
+	// that one exists but isn't private to the user
+	static std::string address();
+
+signals:
+	void requested(QStringList args);
+
+private slots:
+	void accept();
+
+private:
+	QLocalServer* server;
+};
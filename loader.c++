@@ -0,0 +1,200 @@
+/*
+ * loader.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Asynchronous image decoding for PicoView minimal image viewer
+ *
+ */
+
+#include <QImageReader>
+#include <QRunnable>
+#include <QThread>
+#include <QTimer>
+
+#include "cache.h"
+#include "exif.h"
+#include "loader.h"
+#include "mapped.h"
+#include "scale.h"
+#include "trace.h"
+
+class DecodeTask : public QRunnable {
+public:
+	DecodeTask(Loader* _loader, int _request, const fs::path &_file, const QSize &_target, bool _preview = false) :
+		loader(_loader), request(_request), file(_file), target(_target), preview(_preview) {}
+
+	void run() override {
+		ImageCache* cache = loader->cache();
+		Decoded d;
+
+		// Read-ahead only fills the cache
+		if (request < 0) {
+			if (cache->contains(file, target) || !loader->claim(file)) return;
+			cache->insert(Loader::decode(file, target));
+			loader->land(file);
+			return;
+		}
+
+		// Skip the decode entirely if the user has already moved on
+		if (!loader->isLatest(request)) return;
+
+		if (!cache->find(file, target, d)) {
+			loader->await(file);
+			if (!cache->find(file, target, d)) {
+				// A camera file's embedded preview goes up first, long before the full decode is done
+				if (preview) {
+					Decoded p = Loader::preview(file, target);
+					if (!p.image.isNull() && loader->isLatest(request)) {
+						p.request = request;
+						emit loader->decoded(p);
+					}
+				}
+
+				// Superseded mid-decode, what was read so far is of no use to anyone
+				Loader* l = loader;
+				int r = request;
+				d = Loader::decode(file, target, [l, r]() { return !l->isLatest(r); });
+				if (!loader->isLatest(request)) return;
+				cache->insert(d);
+			}
+		}
+		d.request = request;
+		emit loader->decoded(d);
+	}
+
+private:
+	Loader* loader;
+	int request;                        // -1 for read-ahead
+	fs::path file;
+	QSize target;
+	bool preview;                       // Deliver the embedded preview ahead of the decode
+};
+
+class HintTask : public QRunnable {
+public:
+	HintTask(const std::vector<fs::path> &_paths) : paths(_paths) {}
+
+	void run() override {
+		for (const auto &f : paths) MappedFile::willNeed(f);
+	}
+
+private:
+	std::vector<fs::path> paths;
+};
+
+Loader::Loader(QObject* parent, ImageCache* shared) : QObject(parent), latest(-1) {
+	qRegisterMetaType<Decoded>("Decoded");
+	pool.setMaxThreadCount(QThread::idealThreadCount());
+	owned = !shared;
+	_cache = shared ? shared : new ImageCache;
+}
+Loader::~Loader() {
+	latest = -1;
+	pool.clear();
+	pool.waitForDone();
+	if (owned) delete _cache;
+}
+
+int Loader::request(const fs::path &f, const QSize &target, bool preview) {
+	int r = ++latest;
+
+	// Anything still queued is either a stale request or read-ahead for the old position
+	pool.clear();
+
+	// Only a hit that is already the right size is delivered from here. One that has to be shrunk
+	// goes to the pool like a miss, the task finds it in the cache and scales it off the GUI thread
+	Decoded d;
+	if (_cache->find(f, target, d, false) && d.image.size() == ImageCache::fitted(d.native, target)) {
+		d.request = r;
+		QTimer::singleShot(0, this, [this, d]() { emit decoded(d); });
+	}
+	else pool.start(new DecodeTask(this, r, f, target, preview), 1);
+	return r;
+}
+
+void Loader::cancel() {
+	++latest;
+	pool.clear();
+}
+
+void Loader::prefetch(const std::vector<fs::path> &paths, const QSize &target) {
+	for (const auto &f : paths) pool.start(new DecodeTask(this, -1, f, target), 0);
+}
+
+void Loader::advise(const std::vector<fs::path> &paths) {
+	// Ahead of the decodes, each hint is a syscall or two. Opening can still block on NFS,
+	// so not on the GUI thread
+	pool.start(new HintTask(paths), 2);
+}
+
+bool Loader::claim(const fs::path &f) {
+	QMutexLocker lock(&mutex);
+	return flying.insert(f.string()).second;
+}
+void Loader::land(const fs::path &f) {
+	QMutexLocker lock(&mutex);
+	flying.erase(f.string());
+	landed.wakeAll();
+}
+void Loader::await(const fs::path &f) {
+	QMutexLocker lock(&mutex);
+	while (flying.count(f.string())) landed.wait(&mutex);
+}
+
+Decoded Loader::preview(const fs::path &f, const QSize &target) {
+	Decoded d;
+	d.file = f;
+	d.preview = true;
+
+	// Only worth it where the full decode takes long enough to be seen
+	QImageReader reader(QString::fromStdString(f.string()));
+	reader.setAutoTransform(true);
+	d.native = reader.size();
+	if (reader.transformation() & QImageIOHandler::TransformationRotate90) d.native.transpose();
+	if (!d.native.isValid() || size_t(d.native.width()) * d.native.height() < preview_pixels) return d;
+
+	QImage image = exif::preview(f);
+	if (image.isNull()) return d;
+	QSize fit = ImageCache::fitted(image.size(), target);
+	d.image = fit.width() < image.width() ? scale::downscale(image, fit) : image;
+	return d;
+}
+
+Decoded Loader::decode(const fs::path &f, const QSize &target, Cancelled cancelled) {
+	Decoded d;
+	d.file = f;
+
+	MappedFile mapped(f, cancelled);
+	QImageReader reader;
+	mapped.attach(reader);
+
+	// Exif orientation is applied by the codec, [native] and {fit} are of the upright image
+	reader.setAutoTransform(true);
+	d.native = reader.size();
+	bool turned = reader.transformation() & QImageIOHandler::TransformationRotate90;
+	if (turned) d.native.transpose();
+
+	// When the target is much smaller than the source let the codec decode at reduced
+	// size (JPEG scales in the DCT), rather than decoding everything and throwing it away
+	QSize fit = ImageCache::fitted(d.native, target);
+	bool reduced = d.native.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize) &&
+		fit.width() * 2 <= d.native.width() && fit.height() * 2 <= d.native.height();
+	if (reduced) reader.setScaledSize(turned ? fit.transposed() : fit);
+
+	{
+		TRACE_SCOPE("decode");
+		if (!reader.read(&d.image)) return d;
+	}
+	if (!d.native.isValid()) d.native = d.image.size();
+	if (cancelled && cancelled()) return d;
+
+	// If the image's native resolution exceeds the container size, attempt to scale down accordingly
+	fit = ImageCache::fitted(d.native, target);
+	if (d.image.size() != fit) {
+		TRACE_SCOPE("scale");
+		d.image = scale::downscale(d.image, fit);
+	}
+	return d;
+}
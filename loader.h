@@ -0,0 +1,105 @@
+/*
+ * loader.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Asynchronous image decoding for PicoView minimal image viewer,
+ * decodes and scales on a worker pool and delivers the result
+ * back to the GUI thread through the [decoded] signal
+ *
+ */
+
+#pragma once
+
+// std
+#include <atomic>
+#include <experimental/filesystem>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Qt
+#include <QImage>
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+#include <QSize>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include "mapped.h"
+
+namespace fs = std::experimental::filesystem;
+
+struct Decoded {
+	int request = -1;
+	fs::path file;
+	QImage image;                       // Scaled to fit the requested target
+	QSize native;                       // Native resolution of the source, upright
+	bool preview = false;               // The embedded preview, the full decode follows
+};
+Q_DECLARE_METATYPE(Decoded)
+
+class ImageCache;
+
+class Loader : public QObject {
+	Q_OBJECT
+
+public:
+	// Decodes go into {shared} if given, e.g. the cache of another window, otherwise one of its own
+	Loader(QObject* parent = Q_NULLPTR, ImageCache* shared = Q_NULLPTR);
+	~Loader();
+
+	// Queue {f} for decoding, scaled down to fit {target}. Returns the request id
+	// which is echoed back in [Decoded::request]. Cache hits are delivered on the
+	// next pass of the event loop without touching the pool. With {preview} a camera
+	// file's embedded preview is delivered first, while the full decode runs
+	int request(const fs::path &f, const QSize &target, bool preview = true);
+
+	// Decode {paths} into the cache at low priority, in the order given. A request for
+	// a file already being read ahead waits for that decode rather than starting another
+	void prefetch(const std::vector<fs::path> &paths, const QSize &target);
+
+	// Have the kernel read {paths} into the page cache, so their decodes later don't wait on the disk
+	void advise(const std::vector<fs::path> &paths);
+
+	ImageCache* cache() { return _cache; }
+
+	// True if {r} is still the most recent request, older requests are dropped
+	bool isLatest(int r) const { return r == latest.load(); }
+
+	// Drop the outstanding request, stopping its decode if it has started
+	void cancel();
+
+	// Decode and scale synchronously on the calling thread. An invalid {target}
+	// decodes at full native resolution, e.g. for zooming. Once {cancelled} the
+	// decode stops early and the result is to be thrown away
+	static Decoded decode(const fs::path &f, const QSize &target, Cancelled cancelled = nullptr);
+
+	// The embedded Exif preview of {f} scaled to fit {target}, null for images too small to
+	// bother or without one
+	static Decoded preview(const fs::path &f, const QSize &target);
+
+	static const size_t preview_pixels = 4 << 20;   // Smallest image [preview] is tried for
+
+signals:
+	void decoded(Decoded d);
+
+private:
+	friend class DecodeTask;
+
+	// Read-ahead in flight, keyed by path. [claim] is false if {f} is already being decoded
+	bool claim(const fs::path &f);
+	void land(const fs::path &f);
+	void await(const fs::path &f);
+
+	QMutex mutex;
+	QWaitCondition landed;
+	std::unordered_set<std::string> flying;
+
+	QThreadPool pool;
+	ImageCache* _cache;
+	bool owned;                         // [_cache] is this loader's own, not shared
+	std::atomic<int> latest;
+};
@@ -8,11 +8,68 @@
  */
 
 #include <QApplication>
+#include <QDesktopWidget>
+#include <QElapsedTimer>
+#include <QPointer>
 #include <QTimer>
 
+#include "batch.h"
+#include "instance.h"
+#include "loader.h"
 #include "picoview.h"
 
+// Open {path} in {w} and bring it up
+static void launch(PicoView &w, const fs::path &path) {
+	bool first = !w.isVisible();
+	if (fs::exists(path)) w.open(path);
+	else w.open(fs::path("."));
+
+	w.setWindowTitle("PicoView");
+	w.showNormal();
+	w.raise();
+	w.activateWindow();
+
+	// Force expansion of {img_container}
+	if (first) w.resize(w.size() + QSize(1, 1));
+}
+
 int main(int argn, char** argv) {
+	QElapsedTimer clock;
+	clock.start();
+
+	// Batch processing shares the decode paths but none of the window
+	for (int ii = 1; ii < argn; ii ++) {
+		if (std::string(argv[ii]) == "--batch") return batch::run(argn, argv);
+	}
+
+	// --startup-time reports how long the first image took to appear, then quits.
+	// --resident keeps one process around, later launches hand it their path and exit.
+	// --new-window opens in a window of its own rather than the resident's last one.
+	// --recursive lists subdirectories too
+	bool timing = false, resident = false, fresh = false, quit = false, deep = false;
+	fs::path path(".");
+	for (int ii = 1; ii < argn; ii ++) {
+		std::string arg(argv[ii]);
+		if (arg == "--startup-time") timing = true;
+		else if (arg == "--resident") resident = true;
+		else if (arg == "--new-window") fresh = true;
+		else if (arg == "--quit") quit = true;
+		else if (arg == "--recursive") deep = true;
+		else path = fs::path(arg);
+	}
+
+	// Relative paths mean nothing to the resident instance, its working directory differs. A
+	// timed launch has to start and quit a process of its own, so it isn't handed over
+	if (resident && !timing) {
+		std::vector<std::string> args;
+		if (fresh) args.push_back("--new-window");
+		if (quit) args.push_back("--quit");
+		if (deep) args.push_back("--recursive");
+		args.push_back(fs::absolute(path).string());
+		if (Instance::forward(args)) return 0;
+		if (quit) return 0;
+	}
+
 	QApplication a (argn, argv);
 	a.setStyle("Fusion");
 
@@ -37,20 +94,46 @@ int main(int argn, char** argv) {
 	
 	a.setPalette(palette);
 
-	PicoView w(palette);
-	
-	fs::path path(".");
-	if (argn > 1) {
-		path = fs::path(argv[1]);
+	// Start decoding the image asked for while the window is still being put together. The
+	// screen bounds the display size, the cache scales it down to the final size for free
+	Loader* loader = new Loader;
+	std::error_code ec;
+	if (fs::is_regular_file(path, ec)) {
+		loader->prefetch({fs::canonical(path, ec)}, QApplication::desktop()->availableGeometry().size());
 	}
-	if (fs::exists(path)) w.open(path);
-	else w.open(fs::path("."));
 
-	w.setWindowTitle("PicoView");
-	w.show();
+	PicoView w(palette, loader);
+	if (timing) w.measureStartup(clock);
+	if (deep) w.recursive(true);
+	launch(w, path);
 
-	// Force expansion of {img_container}
-	w.resize(w.size() + QSize(1, 1));
+	// Closing the window only hides it while resident, the next launch brings it back warm. Further
+	// windows decode into the first one's cache, so they start warm too
+	Instance instance;
+	std::vector<QPointer<PicoView>> windows;
+	if (resident && instance.listen()) {
+		a.setQuitOnLastWindowClosed(false);
+		QObject::connect(&instance, &Instance::requested, [&](QStringList args) {
+			if (args.contains("--quit")) {
+				a.quit();
+				return;
+			}
+			if (args.isEmpty()) return;
+			fs::path p(args.last().toStdString());
+			PicoView* v = &w;
+			if (args.contains("--new-window")) {
+				v = new PicoView(palette, new Loader(Q_NULLPTR, loader->cache()));
+				v->setAttribute(Qt::WA_DeleteOnClose);
+				windows.push_back(v);
+			}
+			if (args.contains("--recursive")) v->recursive(true);
+			launch(*v, p);
+		});
+	}
+
+	int status = a.exec();
 
-	return a.exec();
+	// Windows still open share [w]'s cache, they have to go first
+	for (auto &v : windows) delete v.data();
+	return status;
 }
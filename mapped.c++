@@ -0,0 +1,92 @@
+/*
+ * mapped.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Memory-mapped file input for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <algorithm>
+#include <climits>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped.h"
+
+MappedFile::MappedFile(const fs::path &f, Cancelled cancelled, Access access) : file(f) {
+	buffer.cancelled = cancelled;
+	int fd = ::open(f.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && st.st_size <= INT_MAX) {
+		void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			data = p;
+			length = st.st_size;
+
+			// Decoders read front to back, so read ahead aggressively and drop pages behind. Header
+			// parsing would only pay for reading in the whole file
+			if (access == Sequential) {
+				madvise(data, length, MADV_SEQUENTIAL);
+				madvise(data, length, MADV_WILLNEED);
+			}
+			else madvise(data, length, MADV_RANDOM);
+		}
+	}
+	// The mapping outlives the descriptor
+	::close(fd);
+	if (!data) return;
+
+	raw = QByteArray::fromRawData(static_cast<const char*>(data), int(length));
+	buffer.setBuffer(&raw);
+	buffer.open(QIODevice::ReadOnly);
+}
+MappedFile::~MappedFile() {
+	buffer.close();
+	if (data) munmap(data, length);
+}
+
+void MappedFile::attach(QImageReader &reader) {
+	if (!data) {
+		reader.setFileName(QString::fromStdString(file.string()));
+		return;
+	}
+	// The extension picks the handler first, the same as it would for a file name
+	buffer.seek(0);
+	reader.setDevice(&buffer);
+	reader.setFormat(QByteArray::fromStdString(file.extension().string()).mid(1).toLower());
+}
+
+void MappedFile::advise(size_t offset, size_t n) {
+	if (!data || offset >= length) return;
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t start = offset / page * page;
+	n = std::min(n, length - offset) + (offset - start);
+	madvise(static_cast<char*>(data) + start, n, MADV_WILLNEED);
+}
+
+qint64 MappedFile::Device::readData(char* data, qint64 n) {
+	// Codecs read in small chunks, so this is checked often enough to matter
+	if (cancelled && cancelled()) return -1;
+	return QBuffer::readData(data, n);
+}
+
+// Taken by reference in [willNeed], so it needs storage of its own
+const size_t MappedFile::hint_limit;
+
+void MappedFile::willNeed(const fs::path &f) {
+	int fd = ::open(f.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		posix_fadvise(fd, 0, std::min<size_t>(st.st_size, hint_limit), POSIX_FADV_WILLNEED);
+	}
+	::close(fd);
+}
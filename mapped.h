@@ -0,0 +1,71 @@
+/*
+ * mapped.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Memory-mapped file input for PicoView minimal image viewer. Files
+ * are mapped rather than read and handed to the image readers as a
+ * buffer over the mapping, so no byte is copied on the way in
+ *
+ */
+
+#pragma once
+
+// std
+#include <experimental/filesystem>
+#include <functional>
+
+// Qt
+#include <QBuffer>
+#include <QByteArray>
+#include <QImageReader>
+
+namespace fs = std::experimental::filesystem;
+
+// Cancellation token, true once whatever it was handed to is no longer wanted
+typedef std::function<bool()> Cancelled;
+
+class MappedFile {
+public:
+	enum Access {
+		Sequential,                     // Decoded front to back, read well ahead and drop pages behind
+		Random                          // Only a header and a range or two are touched, no read-ahead
+	};
+
+	// Reads through the mapping fail once {cancelled} is true, which stops a decode where it stands
+	MappedFile(const fs::path &f, Cancelled cancelled = nullptr, Access access = Sequential);
+	~MappedFile();
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	bool isOpen() const { return data != nullptr; }
+	size_t size() const { return length; }
+	const unsigned char* bytes() const { return static_cast<const unsigned char*>(data); }
+
+	// Point {reader} at the start of the mapping, or at the file itself if it couldn't be mapped
+	void attach(QImageReader &reader);
+
+	// Have the kernel read {n} bytes from {offset} in ahead of use, for [Random] access
+	void advise(size_t offset, size_t n);
+
+	// Have the kernel start reading {f} into the page cache, without waiting for it
+	static void willNeed(const fs::path &f);
+
+	static const size_t hint_limit = size_t(64) << 20;  // Bytes of a file [willNeed] asks for at most
+
+private:
+	class Device : public QBuffer {
+	public:
+		Cancelled cancelled;
+
+	protected:
+		qint64 readData(char* data, qint64 n) override;
+	};
+
+	fs::path file;
+	void* data = nullptr;
+	size_t length = 0;
+	QByteArray raw;                     // Wraps [data] without owning or copying it
+	Device buffer;
+};
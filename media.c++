@@ -0,0 +1,269 @@
+/*
+ * media.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Header sniffing for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "media.h"
+
+namespace media {
+
+static uint32_t be16(const unsigned char* p) { return (p[0] << 8) | p[1]; }
+static uint32_t be32(const unsigned char* p) { return (uint32_t(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+static uint32_t le16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+static uint32_t le24(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16); }
+static uint32_t le32(const unsigned char* p) { return le24(p) | (uint32_t(p[3]) << 24); }
+
+static MediaInfo info(MediaClass kind, int width = 0, int height = 0) {
+	MediaInfo m;
+	m.kind = kind;
+	m.width = width;
+	m.height = height;
+	return m;
+}
+
+static MediaInfo gif(const unsigned char* d, size_t n) {
+	MediaInfo m = info(MediaClass::still, int(le16(d + 6)), int(le16(d + 8)));
+
+	// Walk the blocks until a second frame or a looping extension shows up
+	size_t p = 13;
+	if (d[10] & 0x80) p += 3 << ((d[10] & 0x07) + 1);
+	int frames = 0;
+	while (p < n) {
+		if (d[p] == 0x21 && p + 1 < n) {
+			if (d[p + 1] == 0xFF && p + 14 <= n && (!memcmp(d + p + 3, "NETSCAPE2.0", 11) || !memcmp(d + p + 3, "ANIMEXTS1.0", 11))) {
+				m.kind = MediaClass::animation;
+				return m;
+			}
+			p += 2;
+		}
+		else if (d[p] == 0x2C && p + 10 <= n) {
+			if (++frames > 1) {
+				m.kind = MediaClass::animation;
+				return m;
+			}
+			unsigned char flags = d[p + 9];
+			p += 10;
+			if (flags & 0x80) p += 3 << ((flags & 0x07) + 1);
+			p += 1;                     // LZW minimum code size
+		}
+		else break;
+
+		// Skip the data sub-blocks
+		while (p < n && d[p] != 0) p += d[p] + 1;
+		p += 1;
+	}
+	return m;
+}
+
+static MediaInfo png(const unsigned char* d, size_t n) {
+	MediaInfo m = info(MediaClass::still, int(be32(d + 16)), int(be32(d + 20)));
+
+	// An acTL chunk ahead of the image data makes it an APNG
+	for (size_t p = 8; p + 8 <= n; ) {
+		if (!memcmp(d + p + 4, "acTL", 4)) {
+			m.kind = MediaClass::animation;
+			break;
+		}
+		if (!memcmp(d + p + 4, "IDAT", 4)) break;
+		p += 12 + be32(d + p);
+	}
+	return m;
+}
+
+static MediaInfo webp(const unsigned char* d, size_t n) {
+	MediaInfo m = info(MediaClass::still);
+	if (!memcmp(d + 12, "VP8X", 4) && n >= 30) {
+		if (d[20] & 0x02) m.kind = MediaClass::animation;
+		m.width = le24(d + 24) + 1;
+		m.height = le24(d + 27) + 1;
+	}
+	else if (!memcmp(d + 12, "VP8 ", 4) && n >= 30) {
+		m.width = le16(d + 26) & 0x3FFF;
+		m.height = le16(d + 28) & 0x3FFF;
+	}
+	else if (!memcmp(d + 12, "VP8L", 4) && n >= 25) {
+		uint32_t b = le32(d + 21);
+		m.width = (b & 0x3FFF) + 1;
+		m.height = ((b >> 14) & 0x3FFF) + 1;
+	}
+	return m;
+}
+
+static MediaInfo jpeg(const unsigned char* d, size_t n) {
+	MediaInfo m = info(MediaClass::still);
+
+	// Walk the marker segments to the first start-of-frame
+	for (size_t p = 2; p + 4 <= n; ) {
+		if (d[p] != 0xFF) break;
+		unsigned char marker = d[p + 1];
+		if (marker == 0xFF) {
+			p ++;
+			continue;
+		}
+		if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+			if (p + 9 <= n) {
+				m.height = be16(d + p + 5);
+				m.width = be16(d + p + 7);
+			}
+			break;
+		}
+		if (marker == 0xD9 || marker == 0xDA) break;
+		p += 2 + be16(d + p + 2);
+	}
+	return m;
+}
+
+static MediaInfo ftyp(const unsigned char* d) {
+	// HEIF and AVIF stills share the container with video
+	MediaInfo m = info(MediaClass::video);
+	const char* stills[] = {"heic", "heix", "mif1", "avif"};
+	for (const char* s : stills) {
+		if (!memcmp(d + 8, s, 4)) m.kind = MediaClass::still;
+	}
+	return m;
+}
+
+MediaInfo sniff(const unsigned char* d, size_t n) {
+	if (n >= 13 && (!memcmp(d, "GIF87a", 6) || !memcmp(d, "GIF89a", 6))) return gif(d, n);
+	if (n >= 24 && !memcmp(d, "\x89PNG\r\n\x1a\n", 8)) return png(d, n);
+	if (n >= 8 && !memcmp(d, "\x8aMNG", 4)) return info(MediaClass::animation);
+	if (n >= 16 && !memcmp(d, "RIFF", 4) && !memcmp(d + 8, "WEBP", 4)) return webp(d, n);
+	if (n >= 4 && d[0] == 0xFF && d[1] == 0xD8) return jpeg(d, n);
+	if (n >= 26 && !memcmp(d, "BM", 2)) {
+		int32_t h = int32_t(le32(d + 22));
+		return info(MediaClass::still, int(le32(d + 18)), h < 0 ? -h : h);
+	}
+	if (n >= 12 && !memcmp(d + 4, "ftyp", 4)) return ftyp(d);
+	return MediaInfo();
+}
+
+static uint64_t be64(const unsigned char* p) { return (uint64_t(be32(p)) << 32) | be32(p + 4); }
+
+// Iterate the boxes in [d, d + n), calling {fn(type, payload, size)} until it returns true
+template <typename F>
+static bool boxes(const unsigned char* d, size_t n, F fn) {
+	for (size_t p = 0; p + 8 <= n; ) {
+		uint64_t size = be32(d + p);
+		size_t header = 8;
+		if (size == 1) {
+			if (p + 16 > n) break;
+			size = be64(d + p + 8);
+			header = 16;
+		}
+		else if (size == 0) size = n - p;
+		if (size < header || size > n - p) break;
+		if (fn(d + p + 4, d + p + header, size_t(size - header))) return true;
+		p += size;
+	}
+	return false;
+}
+
+static bool trak(const unsigned char* d, size_t n, MediaInfo &m) {
+	bool video = false;
+	int width = 0, height = 0;
+	std::string codec;
+
+	std::function<bool(const unsigned char*, const unsigned char*, size_t)> walk;
+	walk = [&](const unsigned char* type, const unsigned char* b, size_t len) {
+		if (!memcmp(type, "mdia", 4) || !memcmp(type, "minf", 4) || !memcmp(type, "stbl", 4)) {
+			boxes(b, len, walk);
+		}
+		else if (!memcmp(type, "tkhd", 4) && len >= 84) {
+			// Presentation size as 16.16 fixed point after the matrix
+			size_t at = b[0] == 1 ? 88 : 76;
+			if (len >= at + 8) {
+				width = be32(b + at) >> 16;
+				height = be32(b + at + 4) >> 16;
+			}
+		}
+		else if (!memcmp(type, "hdlr", 4) && len >= 12) {
+			video = !memcmp(b + 8, "vide", 4);
+		}
+		else if (!memcmp(type, "stsd", 4) && len >= 16) {
+			codec.assign(reinterpret_cast<const char*>(b + 12), 4);
+
+			// Coded size from the visual sample entry, in case tkhd left it out
+			if (len >= 8 + 8 + 28 && (width == 0 || height == 0)) {
+				width = be16(b + 8 + 8 + 24);
+				height = be16(b + 8 + 8 + 26);
+			}
+		}
+		return false;
+	};
+	boxes(d, n, walk);
+
+	if (!video) return false;
+	m.width = width;
+	m.height = height;
+	m.codec = codec;
+	return true;
+}
+
+bool moov(const unsigned char* d, size_t n, MediaInfo &m) {
+	bool found = false;
+	boxes(d, n, [&](const unsigned char* type, const unsigned char* b, size_t len) {
+		if (!memcmp(type, "mvhd", 4) && len >= 20) {
+			uint32_t timescale = b[0] == 1 ? (len >= 32 ? be32(b + 20) : 0) : be32(b + 12);
+			uint64_t duration = b[0] == 1 ? (len >= 32 ? be64(b + 24) : 0) : be32(b + 16);
+			if (timescale) m.duration = double(duration) / timescale;
+		}
+		else if (!memcmp(type, "trak", 4) && !found) {
+			found = trak(b, len, m);
+		}
+		return false;
+	});
+	return found;
+}
+
+// Seek through the top level boxes of {f} to moov, which is often at the end of the file
+static void bmff(FILE* f, MediaInfo &m) {
+	const uint64_t limit = 64 << 20;
+	unsigned char header[16];
+	uint64_t at = 0;
+	while (fseeko(f, at, SEEK_SET) == 0 && fread(header, 1, 8, f) == 8) {
+		uint64_t size = be32(header);
+		uint64_t skip = 8;
+		if (size == 1) {
+			if (fread(header + 8, 1, 8, f) != 8) return;
+			size = be64(header + 8);
+			skip = 16;
+		}
+		if (!memcmp(header + 4, "moov", 4)) {
+			if (size == 0 || size - skip > limit) return;
+			std::vector<unsigned char> payload(size - skip);
+			if (fread(payload.data(), 1, payload.size(), f) == payload.size()) moov(payload.data(), payload.size(), m);
+			return;
+		}
+		if (size < skip) return;
+		at += size;
+	}
+}
+
+MediaInfo probe(const fs::path &f) {
+	MediaInfo m;
+	std::unique_ptr<FILE, decltype(&fclose)> file(fopen(f.c_str(), "rb"), fclose);
+	if (file) {
+		std::vector<unsigned char> head(probe_size);
+		size_t n = fread(head.data(), 1, head.size(), file.get());
+		m = sniff(head.data(), n);
+		if (m.kind == MediaClass::video && n >= 8 && !memcmp(head.data() + 4, "ftyp", 4)) bmff(file.get(), m);
+	}
+	if (m.kind == MediaClass::unknown) {
+		m.kind = f.extension() == ".mp4" || f.extension() == ".MP4" ? MediaClass::video : MediaClass::still;
+	}
+	return m;
+}
+
+}
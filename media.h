@@ -0,0 +1,48 @@
+/*
+ * media.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Header sniffing for PicoView minimal image viewer, classifies
+ * files as still images, animations or videos and reads their
+ * dimensions from the first few KB without decoding anything
+ *
+ */
+
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <experimental/filesystem>
+#include <string>
+
+namespace fs = std::experimental::filesystem;
+
+enum class MediaClass : uint8_t { unknown, still, animation, video };
+
+struct MediaInfo {
+	MediaClass kind = MediaClass::unknown;
+	int width = 0;                      // 0 if the header doesn't say
+	int height = 0;
+	double duration = 0;                // Seconds, videos only
+	std::string codec;                  // Sample entry fourcc of the video track, e.g. "avc1"
+};
+
+namespace media {
+
+// Bytes of the file read by [probe], enough for the headers of every format sniffed
+const size_t probe_size = 64 << 10;
+
+// Classify from the leading {n} bytes of a file
+MediaInfo sniff(const unsigned char* data, size_t n);
+
+// Read the head of {f} and classify it, falling back on the extension when the header is unrecognized.
+// ISO-BMFF videos also get their resolution, duration and codec from the moov box
+MediaInfo probe(const fs::path &f);
+
+// Fill resolution, duration and codec of the first video track from a moov box payload
+bool moov(const unsigned char* data, size_t n, MediaInfo &m);
+
+}
@@ -10,53 +10,105 @@
 
 #include "picoview.h"
 
-std::vector<std::string> supported;
-
-PicoView::PicoView(QPalette _palette, QWidget* parent) : QMainWindow(parent), palette(_palette) {
-    // Get supported formats
-    QList<QByteArray> fmts = QImageReader::supportedImageFormats();
-    fmts += QMovie::supportedFormats();
-    for (int ii = 0; ii < fmts.length(); ii ++) {
-        if (!contains<std::string>(supported, fmts[ii].toStdString())) supported.push_back("."+fmts[ii].toStdString());
-    }
-    supported.push_back(".mp4");
-
-	for (const auto &s : supported) {
-		if (&s != &supported.back()) filter += "*"+s+" ";
-		else filter += 	"*"+s+")";	
-	}
+const std::unordered_set<std::string> &supportedFormats() {
+	// Enumerating the format plugins is slow, so it waits for the first listing, which runs
+	// on the scanner's thread. Hashed so filtering a listing is a constant time lookup per entry
+	static const std::unordered_set<std::string> formats = []() {
+		std::unordered_set<std::string> f;
+		QList<QByteArray> fmts = QImageReader::supportedImageFormats();
+		fmts += QMovie::supportedFormats();
+		for (const auto &e : fmts) f.insert("."+e.toStdString());
+		f.insert(".mp4");
+		return f;
+	}();
+	return formats;
+}
 
+PicoView::PicoView(QPalette _palette, Loader* _loader, QWidget* parent) : QMainWindow(parent), palette(_palette) {
 	label_size = QSize(800, 400);
 
+	// Resizes rescale from [source] immediately and settle on a smooth rescale once they stop
+	resize_timer = new QTimer(this);
+	resize_timer->setSingleShot(true);
+	resize_timer->setInterval(150);
+	connect(resize_timer, &QTimer::timeout, this, &PicoView::settle);
+
+	// Changes from [watcher] are written to the directory's index once they quiet down
+	index_timer = new QTimer(this);
+	index_timer->setSingleShot(true);
+	index_timer->setInterval(2000);
+	connect(index_timer, &QTimer::timeout, this, &PicoView::saveIndex);
+
 	w = new PicoWidget(this, this);
 	w->setPalette(palette);
 	this->setCentralWidget(w);
 	
-	img_container = new QLabel;
-	img_container->setAlignment(Qt::AlignCenter);
+	img_container = new PicoCanvas;
 	img_container->setMinimumSize(label_size);
 	
-	mov = new QMovie;
+	// Animations are decoded once at display size and replayed from memory
+	anim = new Animation(this);
+	connect(anim, &Animation::frame, img_container, [this](const QImage &frame) {
+		TRACE_SCOPE("frame");
+		img_container->setFrame(frame);
+		shown();
+	});
+
+	// Keep [files] in step with the directory instead of rescanning it
+	watcher = new DirWatcher(this);
+	connect(watcher, &DirWatcher::changed, this, &PicoView::fileChanged);
+	connect(watcher, &DirWatcher::removed, this, &PicoView::fileRemoved);
+	connect(watcher, &DirWatcher::overflowed, this, &PicoView::rescan);
+
+	// Directories are listed in the background and stream into [files]
+	scanner = new DirScanner(this);
+	connect(scanner, &DirScanner::batch, this, &PicoView::scanned);
+	connect(scanner, &DirScanner::finished, this, &PicoView::scanFinished);
+	connect(scanner, &DirScanner::failed, this, &PicoView::scanFailed);
+
+	// Deletes are moved aside in the background and committed in batches, until then they can be undone
+	trash = new Trash(this);
+	connect(trash, &Trash::restored, this, &PicoView::restored);
+	connect(trash, &Trash::failed, this, &PicoView::trashFailed);
+
+	// Possibly handed over already decoding the first image
+	loader = _loader ? _loader : new Loader;
+	loader->setParent(this);
+	connect(loader, &Loader::decoded, this, &PicoView::present);
+
+	if (const char* d = std::getenv("PICOVIEW_DEPTH")) max_depth = std::atoi(d);
+
+	// Decoded image cache budget in MB, defaults to 256
+	if (const char* mb = std::getenv("PICOVIEW_CACHE_MB")) loader->cache()->setBudget(size_t(std::atoi(mb)) << 20);
 
 	vid_container = new QWidget(w);
 	vid_container->setStyleSheet("background: gray");
 	vid_container->hide();
 
-	vid = new QVideoWidget(vid_container);
+	// [vid] and [player] are only created for the first video, see [ensurePlayer]
 
-    QVBoxLayout* vid_vert = new QVBoxLayout(vid_container);
-    QHBoxLayout* vid_horz = new QHBoxLayout;
-    
-    vid_horz->addWidget(vid, 0, Qt::AlignCenter);
-    vid_vert->addLayout(vid_horz);
-    vid_vert->setAlignment(Qt::AlignCenter);
-    
-	player = new QMediaPlayer;
-	player->setVideoOutput(vid);
-    player->setNotifyInterval(10);
+	// Filmstrip and grid share one view over [files], fed from the persistent thumbnail cache
+	thumbs = new ThumbCache(this);
+	thumb_model = new ThumbModel(&files, thumbs, this);
+	strip = new QListView(w);
+	strip->setModel(thumb_model);
+	strip->setViewMode(QListView::IconMode);
+	strip->setMovement(QListView::Static);
+	strip->setResizeMode(QListView::Adjust);
+	strip->setUniformItemSizes(true);
+	strip->setIconSize(QSize(ThumbCache::size, ThumbCache::size));
+	strip->setGridSize(QSize(ThumbCache::size + 12, ThumbCache::size + 12));
+	strip->setFocusPolicy(Qt::NoFocus);
+	strip->hide();
+	connect(strip, &QListView::clicked, this, &PicoView::thumbActivated);
+	connect(thumbs, &ThumbCache::ready, this, &PicoView::thumbReady);
+
+	// Held arrow keys step faster than images decode, previews are shown until they let go
+	nav_timer = new QTimer(this);
+	nav_timer->setSingleShot(true);
+	nav_timer->setInterval(repeat_interval);
+	connect(nav_timer, &QTimer::timeout, this, [this]() { current(cidx); });
 
-    connect(player, SIGNAL(positionChanged(qint64)), this, SLOT(videoLooper(qint64)));
-    
 	// Create image title and dimensions labels	
 	info = new QLabel;
 	info->setMinimumSize(QSize(0, info->minimumSizeHint().height()));
@@ -65,18 +117,58 @@ PicoView::PicoView(QPalette _palette, QWidget* parent) : QMainWindow(parent), pa
 	dimensions = new QLabel;
 	dimensions->setAlignment(Qt::AlignCenter);
 
+	timings = new QLabel;
+	timings->setAlignment(Qt::AlignCenter);
+	timings->hide();
+
+	// Memory held by decoded media against the [Governor]'s cap, refreshed while shown
+	memory = new QLabel;
+	memory->setAlignment(Qt::AlignCenter);
+	memory->hide();
+	memory_timer = new QTimer(this);
+	memory_timer->setInterval(1000);
+	connect(memory_timer, &QTimer::timeout, this, &PicoView::updateMemory);
+
+	count = new QLabel;
+	count->setAlignment(Qt::AlignCenter);
+
 	buildLayout();
 	current(-1);
 
+	// PICOVIEW_TRACE=<file> traces from startup and writes the trace there on exit
+	if (std::getenv("PICOVIEW_TRACE")) tracing(true);
+
 	norm_geometry = frameGeometry();
 }
+PicoView::~PicoView() {
+	saveIndex();
+	if (const char* f = std::getenv("PICOVIEW_TRACE")) trace::save(f);
+}
+
+void PicoView::ensurePlayer() {
+	if (player) return;
+	vid = new QVideoWidget(vid_container);
+
+    QVBoxLayout* vid_vert = new QVBoxLayout(vid_container);
+    QHBoxLayout* vid_horz = new QHBoxLayout;
+    
+    vid_horz->addWidget(vid, 0, Qt::AlignCenter);
+    vid_vert->addLayout(vid_horz);
+    vid_vert->setAlignment(Qt::AlignCenter);
+    
+	player = new QMediaPlayer(this);
+	player->setVideoOutput(vid);
+    connect(player, &QMediaPlayer::mediaStatusChanged, this, &PicoView::videoLooper);
+}
 
 void PicoView::resizeEvent(QResizeEvent* e) {
+	TRACE_SCOPE("resizeEvent");
 	QMainWindow::resizeEvent(e);
 	w->setMaximumSize(this->size());
 	if (img_container->isVisible()) label_size = img_container->size();
 	else label_size = vid_container->size();
-	current(cidx);
+	rescale(Qt::FastTransformation);
+	resize_timer->start();
 
     if (frameGeometry().topLeft() != QPoint(0, 0)) {
         norm_geometry = frameGeometry();
@@ -90,18 +182,23 @@ void PicoView::open(const fs::path &p) {
 }
 
 void PicoView::getFileList(bool sort) {
+	TRACE_SCOPE("getFileList");
 	std::string ext;
 	fs::path p;
-	files = {};
+	files.clear();
 	for (const auto &e : fs::directory_iterator(path)) {
 		p = e.path();
 		ext = tolower(p.extension().string());
-		if (contains<std::string>(supported, ext)) {
-			p.replace_extension(ext);
-			files.push_back(p);
+		if (supportedFormats().count(ext)) {
+			// One stat per file here, sorting works from the table afterwards
+			files.push_back(FileEntry::stat(p, ext));
 		}
 	}
-	if (sort) sortby(sorting);
+	if (sort) files.sort(_sort_options.find(sorting.toStdString())->second);
+	indexed = path;
+	listed = true;
+	watcher->watch(path);
+	thumbs->open(path);
 }
 
 void PicoView::buildLayout() { 
@@ -120,6 +217,9 @@ void PicoView::buildLayout() {
 	QObject::connect(_refr, &QPushButton::clicked, this, &PicoView::refresh);
 	QObject::connect(_refr_shortcut, &QShortcut::activated, this, &PicoView::refresh);
 
+	QShortcut* _undo_shortcut = new QShortcut(QKeySequence::Undo, this);
+	QObject::connect(_undo_shortcut, &QShortcut::activated, this, &PicoView::undo);
+
 	// Load the refresh icon and set it for the refresh button
 	QIcon r(QPixmap(":/Refresh.png"));
 	_refr->setIcon(r);
@@ -132,6 +232,7 @@ void PicoView::buildLayout() {
 	img_container->show();
 	canvas->addLayout(tbar_layout);
 	canvas->addLayout(media);
+	canvas->addWidget(strip);
 	canvas->addLayout(controls_layout);
 
 	layout->addLayout(canvas);
@@ -160,7 +261,57 @@ void PicoView::buildMenu() {
 	}
 	QObject::connect(mapper, SIGNAL(mapped(QString)), this, SLOT(sortby(QString)));
 
+	// Populate view menu from _view_actions vector, zooming acts directly on the canvas
+	view = new QMenu("&View", w);
+	view->show();
+	idx = 0;
+	for (const auto &e : _view_actions) {
+		QAction* act = new QAction(e.c_str(), this);
+		act->setShortcut(_view_keys[idx]);
+		QObject::connect(act, &QAction::triggered, img_container, _view_slots[idx++]);
+		view->addAction(act);
+		this->addAction(act);
+	}
+	view->addSeparator();
+
+	_filmstrip = new QAction("Filmstrip", this);
+	_filmstrip->setShortcut(QKeySequence("Ctrl+T"));
+	_filmstrip->setCheckable(true);
+	QObject::connect(_filmstrip, &QAction::triggered, this, &PicoView::filmstrip);
+	view->addAction(_filmstrip);
+	this->addAction(_filmstrip);
+
+	_grid = new QAction("Grid", this);
+	_grid->setShortcut(QKeySequence("Ctrl+G"));
+	_grid->setCheckable(true);
+	QObject::connect(_grid, &QAction::triggered, this, &PicoView::gridView);
+	view->addAction(_grid);
+	this->addAction(_grid);
+
+	_recursive = new QAction("Recursive", this);
+	_recursive->setShortcut(QKeySequence("Ctrl+R"));
+	_recursive->setCheckable(true);
+	QObject::connect(_recursive, &QAction::toggled, this, &PicoView::recursive);
+	view->addAction(_recursive);
+	this->addAction(_recursive);
+	view->addSeparator();
+
+	_tracing = new QAction("Tracing", this);
+	_tracing->setShortcut(QKeySequence("F12"));
+	_tracing->setCheckable(true);
+	QObject::connect(_tracing, &QAction::toggled, this, &PicoView::tracing);
+	view->addAction(_tracing);
+	this->addAction(_tracing);
+
+	_memory = new QAction("Memory Usage", this);
+	_memory->setShortcut(QKeySequence("Ctrl+M"));
+	_memory->setCheckable(true);
+	QObject::connect(_memory, &QAction::toggled, this, &PicoView::memoryUsage);
+	view->addAction(_memory);
+	this->addAction(_memory);
+
 	menu->addMenu(file);
+	menu->addMenu(view);
 	menu->addMenu(sort);
 }
 void PicoView::buildControls() {
@@ -196,6 +347,9 @@ void PicoView::buildControls() {
 	dimensions->setMaximumWidth(200);
 	info->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Preferred);
 	_info->addWidget(dimensions);
+	_info->addWidget(timings);
+	_info->addWidget(memory);
+	_info->addWidget(count);
 	_info->addWidget(info);
 
 
@@ -217,72 +371,147 @@ void PicoView::buildControls() {
 	controls.find(">>")->second->setMaximumWidth(30);
 }
 
-void PicoView::current(const int &i) {
+void PicoView::current(const int &shown) {
+	TRACE_SCOPE("current");
+	// A listing from [DirIndex] isn't stat-ed, so a file rewritten in place is only caught here
+	int i = shown >= 0 && (unsigned int)shown < files.size() ? int(files.refresh(shown)) : shown;
+
+	// The image already up, decoded in full. Asked for again (larger, or changed on disk) it goes
+	// without the embedded preview, which would only stand in for something sharper
+	bool again = still && !previewing && i >= 0 && (unsigned int)i < files.size() && img_container->path() == files[i].path;
 	cidx = i;
+	pending = -1;
+	previewing = false;
+	nav_timer->stop();
 	if (i >= 0 && (unsigned int)i < files.size()) {
-		if (mov != NULL) {
-			delete mov;
-			mov = NULL;
-		}
-		if (vid_container->isVisible() && !isVideo(files[i])) {
-		    player->stop();
+		// Sniffed from the header once per file and cached in [files]
+		MediaClass kind = files.info(i).kind;
+		still = false;
+		anim->stop();
+		if (vid_container->isVisible() && kind != MediaClass::video) {
+		    if (player) player->stop();
             vid_container->hide();
             img_container->show();
 		}
-		if (isMovie(files[i])) {
-			mov = new QMovie(QString::fromStdString(files[i].string()));
-
-            nframes = mov->frameCount();
-            connect(mov, SIGNAL(frameChanged(int)), this, SLOT(movieLooper(int)));
-
-			// Have to start the movie before calling [->frameRect()]
-			img_container->setMovie(mov);
-			mov->jumpToNextFrame();
-			img_rect = mov->frameRect();
-
-            // Apply scaling and start the movie
-		    mov->setScaledSize(calculateScale());
-			mov->start();
+		if (kind == MediaClass::animation) {
+			img_container->zoomFit();
+			anim->play(files[i].path, label_size);
+			img_rect = QRect(QPoint(0, 0), anim->native());
 		}
-		else if (isVideo(files[i])) {
-		    player->setMedia(QUrl::fromLocalFile(QString::fromStdString(files[i].string())));
+		else if (kind == MediaClass::video) {
+		    ensurePlayer();
+		    player->setMedia(QUrl::fromLocalFile(QString::fromStdString(files[i].path.string())));
 		    img_container->hide();
 		    
-		    // Use ffmpeg's ffprobe to extract resolution information
-            img_rect.setSize(extractResolution(files[i].string()));
+		    // Resolution is parsed from the moov box once and cached with the entry
+            img_rect.setSize(extractResolution(files[i].path));
             vid->setFixedSize(calculateScale());
 
-            vid_container->show();
-            player->play();
+            // Stays paused behind the grid until it is closed
+            if (!show_grid) {
+                vid_container->show();
+                player->play();
+            }
 		}
 		else {
-			img.load(QString::fromStdString(files[i].string()));
-			QPixmap p = QPixmap::fromImage(img);
-			img_rect = p.rect();
-
-			// If the image's native resolution exceeds the container size, attempt to scale down accordingly
-			if (img_rect.height() > label_size.height() || img_rect.width() > label_size.width()) {
-				p = p.scaled(label_size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-			}
+			// Decode and scale off the GUI thread, the previous image stays up until [present]
+			pending = loader->request(files[i].path, label_size, !again);
+		}
+		readAhead();
 
-			img_container->setPixmap(p);
+		if (pending < 0) {
+			dimensions->setText(QString::fromStdString(std::to_string(img_rect.width())+"x"+std::to_string(img_rect.height())));
+			setLabelText(info, QString::fromStdString(files[i].path.filename().string()));
 		}
+	}
 
-		dimensions->setText(QString::fromStdString(std::to_string(img_rect.width())+"x"+std::to_string(img_rect.height())));
-		setLabelText(info, QString::fromStdString(files[i].filename().string()));
+	updateControls();
+}
+
+void PicoView::step(int i) {
+	if (i < 0 || (unsigned int)i >= files.size()) return;
+	bool repeat = nav_clock.isValid() && nav_clock.elapsed() < repeat_interval;
+	nav_clock.start();
+	if (!repeat) {
+		current(i);
+		return;
 	}
+	preview(i);
+	nav_timer->start();
+}
+
+void PicoView::preview(int i) {
+	TRACE_SCOPE("preview");
+	if (i < 0 || (unsigned int)i >= files.size()) return;
+	// Whatever was decoding for the last step is abandoned where it stands
+	loader->cancel();
+	pending = -1;
+	// Before the thumbnail key is built from it, as in [current]
+	i = int(files.refresh(i));
+	cidx = i;
+	previewing = true;
+	const FileEntry &e = files[i];
+
+	// Already decoded at full quality, nothing is gained by waiting
+	if (loader->cache()->contains(e.path, label_size)) {
+		current(i);
+		return;
+	}
+
+	anim->stop();
+	if (vid_container->isVisible()) {
+		if (player) player->stop();
+		vid_container->hide();
+		img_container->show();
+	}
+	// Only the file landed on is worth a thumbnail, [ThumbCache::preview] drops the one before
+	QImage thumb = thumbs->find(e);
+	if (thumb.isNull()) thumbs->preview(e);
+	else showPreview(i, thumb);
+
+	setLabelText(info, QString::fromStdString(e.path.filename().string()));
+	updateControls();
+}
+
+void PicoView::showPreview(int i, const QImage &thumb) {
+	// Stands in for the full decode at the same size on screen, so the zoom carries over
+	const FileEntry &e = files[i];
+	QSize native = e.probed && e.media.width > 0 ? QSize(e.media.width, e.media.height) : thumb.size();
+
+	// The probe reads dimensions as stored, the thumbnail is upright. Whichever way round is closer
+	// to its shape is the Exif orientation applied
+	double aspect = double(thumb.width()) / thumb.height();
+	if (std::abs(double(native.height()) / native.width() - aspect) < std::abs(double(native.width()) / native.height() - aspect)) {
+		native.transpose();
+	}
+	still = true;
+	img_rect = QRect(QPoint(0, 0), native);
+
+	// Copied out of the thumbnail pack, which is unmapped when the directory changes
+	img_container->setImage(thumb.copy(), native, e.path);
+	dimensions->setText(QString::fromStdString(std::to_string(native.width())+"x"+std::to_string(native.height())));
+}
 
+void PicoView::thumbReady(QString p) {
+	if (!previewing || cidx < 0 || (unsigned int)cidx >= files.size()) return;
+	if (files[cidx].path.string() != p.toStdString()) return;
+	QImage thumb = thumbs->find(files[cidx]);
+	if (!thumb.isNull()) showPreview(cidx, thumb);
+}
+
+void PicoView::updateControls() {
+	TRACE_SCOPE("updateControls");
 	_prev = controls.find("Previous")->second;
 	_delt = controls.find("Delete")->second;
 	_next = controls.find("Next")->second;
 
 	// Disable next and previous buttons when appropriate
 	bool empty = files.empty();
-	if (i == 0 || empty) {
+	if (cidx == 0 || empty) {
 		_prev->setEnabled(false);
 		controls.find("<<")->second->setEnabled(false);
 	}
-	if ((unsigned int)i == files.size() - 1 || empty) {
+	if ((unsigned int)cidx == files.size() - 1 || empty) {
 		_next->setEnabled(false);
 		controls.find(">>")->second->setEnabled(false);
 	}
@@ -291,19 +520,118 @@ void PicoView::current(const int &i) {
 	if (empty && _refr->isEnabled()) _refr->setEnabled(false);
 	else _refr->setEnabled(true);
 
+	// Keep the thumbnails in step with [files] and the current position
+	thumb_model->sync();
+	if (strip->isVisible() && cidx >= 0 && (unsigned int)cidx < files.size()) {
+		strip->setCurrentIndex(thumb_model->index(cidx));
+		strip->scrollTo(thumb_model->index(cidx), show_grid ? QAbstractItemView::EnsureVisible : QAbstractItemView::PositionAtCenter);
+	}
+
+	// Position and count, marked while the listing is still streaming in
+	if (empty) count->clear();
+	else count->setText(QString::fromStdString(std::to_string(cidx + 1)+" / "+std::to_string(files.size())+(scanner->isScanning() ? "+" : "")));
+
 	// Re-enable next and previous buttons as needed
-	if (!_prev->isEnabled() && i != 0 && !empty) {
+	if (!_prev->isEnabled() && cidx != 0 && !empty) {
 		_prev->setEnabled(true);
 		controls.find("<<")->second->setEnabled(true);
 	}
-	if (!_next->isEnabled() && (unsigned int)i != files.size() - 1 && !empty) {
+	if (!_next->isEnabled() && (unsigned int)cidx != files.size() - 1 && !empty) {
 		_next->setEnabled(true);
 		controls.find(">>")->second->setEnabled(true);
 	}
 }
 
+void PicoView::present(Decoded d) {
+	// Drop results for anything other than the outstanding request
+	if (d.request != pending || !loader->isLatest(d.request)) return;
+
+	// A preview stands in until the full decode arrives on the same request
+	if (!d.preview) pending = -1;
+
+	{
+		TRACE_SCOPE("present");
+		img_rect = QRect(QPoint(0, 0), d.native);
+		still = true;
+		img_container->setImage(d.image, d.native, d.file);
+
+		dimensions->setText(QString::fromStdString(std::to_string(img_rect.width())+"x"+std::to_string(img_rect.height())));
+		setLabelText(info, QString::fromStdString(d.file.filename().string()));
+	}
+	updateTimings();
+	shown();
+}
+
+void PicoView::measureStartup(const QElapsedTimer &since) {
+	startup = since;
+}
+
+void PicoView::shown() {
+	if (!startup.isValid()) return;
+	std::cerr << "startup: " << startup.elapsed() << " ms to first image" << std::endl;
+	startup.invalidate();
+	QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+}
+
+void PicoView::rescale(Qt::TransformationMode mode) {
+	// Animations and videos are only resized, never reloaded, so they keep playing
+	if (vid_container->isVisible()) {
+		vid->setFixedSize(calculateScale());
+	}
+	else if (anim->isPlaying() || still) {
+		img_container->rescale(mode);
+	}
+}
+
+void PicoView::settle() {
+	TRACE_SCOPE("settle");
+	if (anim->isPlaying()) {
+		anim->resize(label_size);
+		rescale(Qt::SmoothTransformation);
+		return;
+	}
+	if (!still || pending >= 0 || previewing) return;
+
+	// The window grew past what was decoded, go back to the loader (and cache) for a larger one.
+	// Zoomed views beyond this resolution are filled in by the canvas' tiles
+	const QImage &source = img_container->image();
+	QSize target = ImageCache::fitted(img_rect.size(), label_size);
+	if (target.width() > source.width() || target.height() > source.height()) {
+		pending = loader->request(files[cidx].path, label_size, false);
+		readAhead();
+	}
+	else rescale(Qt::SmoothTransformation);
+}
+
+void PicoView::readAhead() {
+	// Weighted toward the direction of travel, nearest first
+	std::vector<fs::path> ahead;
+	auto add = [&](int j) {
+		if (j < 0 || (unsigned int)j >= files.size()) return;
+		const FileEntry &e = files[j];
+		if (e.probed ? e.media.kind == MediaClass::still : e.ext != ".mp4") ahead.push_back(e.path);
+	};
+	for (int ii = 1; ii <= std::max(lookahead, lookbehind); ii ++) {
+		if (ii <= lookahead) add(cidx + ii * direction);
+		if (ii <= lookbehind) add(cidx - ii * direction);
+	}
+	loader->prefetch(ahead, label_size);
+
+	// Further along, only get the bytes off the disk so reaching them doesn't wait on I/O
+	std::vector<fs::path> hints;
+	for (int ii = lookahead + 1; ii <= lookahead + hintahead; ii ++) {
+		int j = cidx + ii * direction;
+		if (j < 0 || (unsigned int)j >= files.size()) break;
+		if (files[j].ext != ".mp4") hints.push_back(files[j].path);
+	}
+	if (!hints.empty()) loader->advise(hints);
+}
+
 // Slots
 void PicoView::open_file() {
+	std::string filter = "(";
+	for (const auto &s : supportedFormats()) filter += "*"+s+" ";
+	filter.back() = ')';
 	std::string _file = QFileDialog::getOpenFileName(this, tr("Open Image"), path.string().c_str(), 
 		tr(("Image Files "+filter).c_str())).toStdString();
 	if (_file == "") return;
@@ -314,18 +642,18 @@ void PicoView::open_file(fs::path _file, bool checking) {
 	fs::path file = fs::canonical(_file);
 
 	if (checking) {
-		if (file.parent_path() == path) goto _open_file;
+		if (file.parent_path() == path || (depth && files.indexOf(file) >= 0)) goto _open_file;
 	}
 	path = fs::canonical(file).remove_filename();
-	getFileList();
+	stream(file);
 
 _open_file:
-	auto found = std::find(files.begin(), files.end(), file);
-	if (found == files.end()) {
+	long found = files.indexOf(file);
+	if (found < 0) {
 		setLabelText(info, QString::fromStdString("Error opening "+file.filename().string()+"."));
 		cidx = 0;
 	}
-	else cidx = std::distance(files.begin(), found); 
+	else cidx = found;
 	current(cidx);
 }
 void PicoView::open_dir() {
@@ -340,57 +668,285 @@ void PicoView::open_dir(fs::path _dir, size_t idx, bool checking) {
 	}
 
     path = fs::canonical(_dir);
-	try {
-	    getFileList();
-	}
-    catch (...) {
-        error("failed to open "+colors::yellow+path.string()+colors::res, __LINE__ - 3, __FILE__);
+    if (stream()) {
+        current(files.empty() ? -1 : std::min<size_t>(idx, files.size() - 1));
         return;
     }
-    current(idx);
+
+    // The first batch selects the first entry, [idx] is applied once the listing is complete
+    scan_idx = idx;
+    current(-1);
+}
+
+bool PicoView::stream(const fs::path &first, bool fresh) {
+	saveIndex();
+	scan_idx = 0;
+
+	// A recursive listing spans directories the index of [path] knows nothing of, so it isn't kept
+	indexed = depth ? fs::path() : path;
+	watcher->watch(path);
+	thumbs->open(path);
+	trash->sweep(path);
+
+	// An unchanged directory comes straight out of its index, nothing is walked or stat-ed. The
+	// watch is already up so anything that changes from here on arrives through [watcher]
+	SortMode m;
+	if (!depth && !fresh && DirIndex::load(path, files, m)) {
+		scanner->cancel();
+		scanning = -1;
+		listed = true;
+		indexed_revision = files.revision();
+		indexed_probes = files.probes();
+		for (const auto &e : _sort_options) {
+			if (e.second == m) sorting = QString::fromStdString(e.first);
+		}
+		return true;
+	}
+
+	// Seed the list with {first} so it can be shown before the directory has been read. It was
+	// asked for by name, so it goes in without waiting on [supportedFormats]
+	listed = false;
+	files.clear();
+
+	// Batches are merged in the list's own order, which has to be the one the Sort menu shows
+	files.sort(_sort_options.find(sorting.toStdString())->second);
+	if (!first.empty()) files.push_back(FileEntry::stat(first, tolower(first.extension().string())));
+
+	scanning = scanner->scan(path, depth);
+	return false;
+}
+
+void PicoView::relist(bool fresh) {
+	// List [path] again, staying on the file shown, or failing that the same position
+	std::error_code ec;
+	int at = cidx;
+	fs::path _file = cidx >= 0 && (unsigned int)cidx < files.size() ? files[cidx].path : fs::path();
+	if (!_file.empty() && !fs::exists(_file, ec)) _file.clear();
+	bool done = stream(_file, fresh);
+	long found = files.indexOf(_file);
+	if (found < 0 && at > 0) {
+		if (done) found = std::min<long>(at, (long)files.size() - 1);
+		else scan_idx = at;
+	}
+	current(found >= 0 ? found : (files.empty() ? -1 : 0));
+}
+
+void PicoView::recursive(bool on) {
+	int d = on ? max_depth : 0;
+	if (d == depth) return;
+	depth = d;
+	_recursive->setChecked(on);
+	if (!path.empty()) relist();
+}
+
+void PicoView::filmstrip() {
+	show_strip = !show_strip;
+	layoutStrip();
+}
+
+void PicoView::gridView() {
+	show_grid = !show_grid;
+	layoutStrip();
+
+	// Back from the grid, bring up whatever is selected
+	if (!show_grid) {
+		img_container->show();
+		current(cidx);
+	}
+}
+
+void PicoView::layoutStrip() {
+	_filmstrip->setChecked(show_strip);
+	_grid->setChecked(show_grid);
+	if (show_grid) {
+		// The grid takes over the media area until an item is picked
+		if (player) player->pause();
+		img_container->hide();
+		vid_container->hide();
+		strip->setWrapping(true);
+		strip->setMinimumHeight(0);
+		strip->setMaximumHeight(QWIDGETSIZE_MAX);
+		strip->show();
+	}
+	else if (show_strip) {
+		strip->setFlow(QListView::LeftToRight);
+		strip->setWrapping(false);
+		strip->setFixedHeight(strip->gridSize().height() + strip->horizontalScrollBar()->sizeHint().height() + 4);
+		strip->show();
+	}
+	else strip->hide();
+	updateControls();
+}
+
+void PicoView::thumbActivated(const QModelIndex &index) {
+	if (!index.isValid()) return;
+	direction = index.row() >= cidx ? 1 : -1;
+	if (show_grid) {
+		cidx = index.row();
+		gridView();
+	}
+	else current(index.row());
+}
+
+void PicoView::tracing(bool on) {
+	trace::enable(on);
+	if (_tracing->isChecked() != on) _tracing->setChecked(on);
+	timings->setVisible(on);
+	updateTimings();
+}
+
+void PicoView::exportTrace() {
+	QString f = QFileDialog::getSaveFileName(this, tr("Export Trace"), "picoview-trace.json", tr("Chrome Trace (*.json)"));
+	if (f.isEmpty()) return;
+	if (!trace::save(f.toStdString())) setLabelText(info, "Failed to write "+f+".");
+}
+
+void PicoView::updateTimings() {
+	if (!trace::enabled()) return;
+	QString text;
+	for (const char* name : {"decode", "scale", "present"}) {
+		int64_t ns = trace::last(name);
+		text += QString("%1 %2  ").arg(name).arg(ns < 0 ? QString("-") : QString::number(ns / 1e6, 'f', 1)+" ms");
+	}
+	timings->setText(text.trimmed());
+}
+
+void PicoView::memoryUsage(bool on) {
+	memory->setVisible(on);
+	if (on) {
+		updateMemory();
+		memory_timer->start();
+	}
+	else memory_timer->stop();
+}
+
+void PicoView::updateMemory() {
+	Governor &g = Governor::instance();
+	memory->setText(QString("%1 / %2 MB").arg(g.used() >> 20).arg(g.cap() >> 20));
+
+	QString detail;
+	for (const auto &u : g.usage()) detail += QString("%1 %2 MB\n").arg(QString::fromStdString(u.first)).arg(u.second >> 20);
+	memory->setToolTip(detail.trimmed());
+}
+
+void PicoView::scanned(int scan, FileBatch b) {
+	if (scan != scanning) return;
+	fs::path _file = cidx >= 0 && (unsigned int)cidx < files.size() ? files[cidx].path : fs::path();
+	files.merge(std::move(b));
+
+	// Nothing shown yet, start with the first entry
+	if (_file.empty()) current(0);
+	else {
+		cidx = files.indexOf(_file);
+		updateControls();
+	}
+}
+
+void PicoView::scanFinished(int scan, size_t total) {
+	Q_UNUSED(total);
+	if (scan != scanning) return;
+	listed = true;
+	saveIndex();
+	if (scan_idx > 0 && !files.empty()) current(std::min<size_t>(scan_idx, files.size() - 1));
+	else updateControls();
+}
+
+void PicoView::scanFailed(int scan, QString message) {
+	if (scan != scanning) return;
+	error("failed to open "+colors::yellow+path.string()+colors::res+": "+message.toStdString(), __LINE__, __FILE__);
 }
 
 void PicoView::sortby(QString s) {
+	TRACE_SCOPE("sortby");
 	if (cidx < 0) return;
 	SortMode m = _sort_options.find(s.toStdString())->second;
-	fs::path _file = files[cidx];
+	fs::path _file = files[cidx].path;
 
-	// Update file list in case of deletion/addition from external source
-	getFileList(false);
+	// Update file list in case of deletion/addition from external source, unless [watcher] already has
+	if (!watcher->isWatching() && !depth) getFileList(false);
 
-	// Reselect the file if it still exists, else go to nearest previous index
-	std::vector<fs::path>::iterator pos = std::find(files.begin(), files.end(), _file);
-	if (pos == files.end()) {
-	    cidx = pos - files.begin();
-	    if ((unsigned)cidx > files.size() - 1) cidx = files.size() - 1;
-	    fs::path _file = files[cidx];
-	}
-	
 	sorting = s;
-	switch(m) {
-		case SortMode::name:
-			std::sort(files.begin(), files.end(), [](auto &l, auto &r) { return l < r; });
-			break;
-			
-		case SortMode::modified:
-			std::sort(files.begin(), files.end(), [](auto &l, auto &r) { return fs::last_write_time(l) < fs::last_write_time(r); });
-			break;
-			
-		case SortMode::type:
-			std::sort(files.begin(), files.end(), [](auto &l, auto &r) { 
-				return (l.extension() < r.extension()) || (l.extension() == r.extension() && l.filename() < r.filename()); 
-			});
-			break;
-	}
+	files.sort(m);
 
+	// Reselect the file if it still exists, else stay at the nearest index
 	// TODO This can be improved: as it is animations restart on every [sortby]
-	current(std::distance(files.begin(), std::find(files.begin(), files.end(), _file)));
+	long found = files.indexOf(_file);
+	if (found < 0) found = std::min<long>(cidx, (long)files.size() - 1);
+	current(found);
+	saveIndex();
 }
 void PicoView::refresh() {
+	// With a live [watcher] the list is already current, only the displayed file is reloaded. It
+	// only sees [path] itself though, not the subdirectories of a recursive listing
+	if (watcher->isWatching() && !depth) {
+		current(cidx);
+		return;
+	}
 	img_container->hide();
 	open_dir(path, cidx, false);
 	img_container->show();
 }
+
+void PicoView::fileChanged(const fs::path &f) {
+	std::string ext = tolower(f.extension().string());
+	if (!supportedFormats().count(ext)) return;
+
+	fs::path _file = cidx >= 0 && (unsigned int)cidx < files.size() ? files[cidx].path : fs::path();
+	files.insert(FileEntry::stat(f, ext));
+	index_timer->start();
+
+	// Rewritten in place, reload it (the cache is keyed on mtime)
+	if (f == _file || _file.empty()) current(std::max<long>(files.indexOf(_file), 0));
+	else {
+		cidx = files.indexOf(_file);
+		updateControls();
+	}
+}
+
+void PicoView::fileRemoved(const fs::path &f) {
+	long i = files.indexOf(f);
+	if (i < 0) return;
+	files.erase(i);
+	index_timer->start();
+	if (i == cidx) current(std::min<long>(cidx, (long)files.size() - 1));
+	else {
+		if (i < cidx) cidx --;
+		updateControls();
+	}
+}
+
+void PicoView::rescan() {
+	// inotify dropped events or lost the directory, list it again in the background. The index
+	// can't be trusted to have seen what was dropped
+	if (path.empty()) return;
+	relist(true);
+}
+
+void PicoView::restored(fs::path f) {
+	std::string ext = tolower(f.extension().string());
+	if ((!depth && f.parent_path() != path) || !supportedFormats().count(ext)) return;
+	files.insert(FileEntry::stat(f, ext));
+	index_timer->start();
+	current(files.indexOf(f));
+}
+
+void PicoView::trashFailed(fs::path f, QString message) {
+	setLabelText(info, message);
+
+	// Still where it was, put it back in the list
+	std::error_code ec;
+	if (f.parent_path() == path && files.indexOf(f) < 0 && fs::exists(f, ec)) fileChanged(f);
+}
+
+void PicoView::saveIndex() {
+	index_timer->stop();
+	if (!listed || indexed.empty()) return;
+	if (files.revision() == indexed_revision && files.probes() == indexed_probes) return;
+	if (DirIndex::save(indexed, files)) {
+		indexed_revision = files.revision();
+		indexed_probes = files.probes();
+	}
+}
 void PicoView::fullscreen() {
     QRect g = frameGeometry();
     if (is_fullscreen) {
@@ -416,54 +972,62 @@ void PicoView::fullscreen() {
     }
 }
 
-void PicoView::movieLooper(int f) {
-    if (f == nframes - 1) {
-        mov->jumpToFrame(0);
-    }
-}
 
-void PicoView::videoLooper(qint64 p) {
-    if (player->duration() && p >= player->duration() - 15) {
+void PicoView::videoLooper(QMediaPlayer::MediaStatus status) {
+    TRACE_SCOPE("videoLooper");
+    if (status == QMediaPlayer::EndOfMedia) {
         player->setPosition(0);
         player->play();
     }
 }
 
 void PicoView::firs() {
+	direction = 1;
 	current(0);
 }
 void PicoView::prev() {
-	if (cidx > 0) current(--cidx);
+	direction = -1;
+	if (cidx > 0) step(cidx - 1);
 }
 void PicoView::delt() {
-	bool success = fs::remove(files[cidx]);
-	if (success) {
-		setLabelText(info, QString::fromStdString("Removed "+files[cidx].filename().string()+"."));
-		files.erase(files.begin() + cidx);
-		current(cidx);
-	}
-	else {
-		setLabelText(info, QString::fromStdString("Failed to remove "+files[cidx].filename().string()+"."));
-	}
+	if (cidx < 0 || (unsigned int)cidx >= files.size()) return;
+
+	// Gone from the list at once, the file itself is moved to the trash in the background
+	fs::path f = files[cidx].path;
+	trash->discard(f);
+	files.erase(cidx);
+	index_timer->start();
+	current(std::min<long>(cidx, (long)files.size() - 1));
+	setLabelText(info, QString::fromStdString("Removed "+f.filename().string()+", Ctrl+Z to undo."));
 }
 void PicoView::next() {
-	if ((unsigned int)cidx < files.size() - 1) current(++cidx);
+	direction = 1;
+	if ((long)cidx + 1 < (long)files.size()) step(cidx + 1);
 }
 void PicoView::last() {
+	direction = -1;
 	current(files.size() - 1);
 }
+void PicoView::undo() {
+	fs::path f = trash->undo();
+	setLabelText(info, QString::fromStdString(f.empty() ? "Nothing to undo." : "Restoring "+f.filename().string()+"."));
+}
 
 // General
 bool PicoView::isMovie(fs::path f) {
-	QMovie m(QString::fromStdString(f.string()));
-	return m.frameCount() > 1;
+	return classify(f).kind == MediaClass::animation;
 }
 bool PicoView::isVideo(fs::path f) {
-    return f.extension() == ".mp4";
+    return classify(f).kind == MediaClass::video;
+}
+MediaInfo PicoView::classify(const fs::path &f) {
+	long i = files.indexOf(f);
+	return i >= 0 ? files.info(i) : media::probe(f);
 }
 
-QSize PicoView::extractResolution(std::string f) {
-    return split(exec("ffprobe -v error -select_streams v:0 -show_entries stream=width,height -of csv=s=,:p=0 "+f), ',');
+QSize PicoView::extractResolution(const fs::path &f) {
+    MediaInfo m = classify(f);
+    return QSize(m.width, m.height);
 }
 
 
@@ -495,27 +1059,3 @@ void error(const std::string mess, const int line, const char* file) {
     printf(std::string("\r"+colors::red+colors::white_back+" Error :"+colors::res+" \"%s\""+" in File "+colors::yellow+"%s"+colors::res+
            " on line "+colors::bright+colors::red+"%d"+colors::res+"\n").c_str(), mess, file, line);
 }
-
-template <typename T>
-void split(const std::string &s, char delim, T result) {
-    std::istringstream iss(s);
-    std::string item;
-    while (std::getline(iss, item, delim)) {
-        *result++ = item;
-    }
-}
-QSize split(const std::string &s, char delim) {
-    std::vector<std::string> v;
-    split(s, delim, std::back_inserter(v));
-    return QSize(std::stoi(v[0]), std::stoi(v[1]));
-}
-
-std::string exec(std::string command) {
-    std::array<char, 128> buffer;
-    std::string result;
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(command.c_str(), "r"), pclose);
-    while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-        result += buffer.data();
-    }
-    return result;
-}
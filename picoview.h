@@ -13,9 +13,12 @@
 
 // std
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <experimental/filesystem>
 #include <iostream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 // Qt
@@ -24,9 +27,11 @@
 #include <QComboBox>
 #include <QDesktopWidget>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QDebug>
 #include <QFileDialog>
 #include <QLabel>
+#include <QListView>
 #include <QtWidgets/QMainWindow>
 #include <QMediaPlayer>
 #include <QMediaPlaylist>
@@ -36,49 +41,80 @@
 #include <QPalette>
 #include <QPushButton>
 #include <QRect>
+#include <QScrollBar>
 #include <QShortcut>
 #include <QSignalMapper>
 #include <QSizePolicy>
+#include <QTimer>
 #include <QWidget>
 #include <QVBoxLayout>
 #include <QVideoWidget>
 
+#include "animation.h"
+#include "cache.h"
+#include "canvas.h"
 #include "colors.h"
+#include "filelist.h"
+#include "governor.h"
+#include "index.h"
+#include "loader.h"
+#include "scanner.h"
+#include "thumbs.h"
+#include "trace.h"
+#include "trash.h"
+#include "watcher.h"
 
 namespace fs = std::experimental::filesystem;
 
-extern std::vector<std::string> supported;
-
-enum SortMode { name, modified, type };
+// Lower case extensions, with the '.', of every format the viewer opens
+const std::unordered_set<std::string> &supportedFormats();
 
 // Forward declarations
 class PicoWidget;
 
 class PicoView : public QMainWindow {
 	Q_OBJECT
+	friend class Bench;                 // bench/bench.c++ drives the viewer's internals directly
+	friend class ViewTest;              // As does tests/view_test.c++
 
 public:
-	PicoView(QPalette palette, QWidget* parent = Q_NULLPTR);
+	// {_loader} may be passed in already decoding the first image, otherwise one is created
+	PicoView(QPalette palette, Loader* _loader = Q_NULLPTR, QWidget* parent = Q_NULLPTR);
+	~PicoView();
 
 	void resizeEvent(QResizeEvent* e);
 
 	void open(const fs::path &p);
 
+	// Print the time since {since} once the first image is up, then quit
+	void measureStartup(const QElapsedTimer &since);
+
 	void getFileList(bool sort = true);
 	void buildLayout();
 	void buildMenu();
 	void buildControls();
 
 	void current(const int &i);
+	void step(int i);                   // [current] for next/previous, coalescing key repeat into [preview]s
+	void preview(int i);
+	void showPreview(int i, const QImage &thumb);
+	void updateControls();
+	void readAhead();
+	void rescale(Qt::TransformationMode mode);
+	void ensurePlayer();
+	void shown();
 
 	bool isMovie(fs::path f);
     bool isVideo(fs::path f);
+    MediaInfo classify(const fs::path &f);
 
-    QSize extractResolution(std::string);
+    QSize extractResolution(const fs::path &f);
     QSize calculateScale();
     
 	void open_file(fs::path _file, bool checking = true);
 	void open_dir(fs::path _dir, size_t idx = 0, bool checking = true);
+	bool stream(const fs::path &first = fs::path(), bool fresh = false);    // {fresh} skips the index
+	void relist(bool fresh = false);
 
 public slots:
 	void open_file();
@@ -88,22 +124,58 @@ public slots:
 	void refresh();
 	void fullscreen();
 
-	void movieLooper(int f);            // Native looping of WebP animations ocassionally fails with Qt 5.9.5, have to handle manually.
-	void videoLooper(qint64 p);         // For looping mp4 videos
+	void present(Decoded d);            // Receives decoded images from [loader] on the GUI thread
+	void settle();                      // Smooth rescale once resizing has stopped
+
+	void fileChanged(const fs::path &f);    // Incremental updates from [watcher]
+	void fileRemoved(const fs::path &f);
+	void rescan();
+	void restored(fs::path f);          // From [trash]
+	void trashFailed(fs::path f, QString message);
+	void saveIndex();                   // Write [files] to the [DirIndex] of [indexed] if it changed since the last save
+
+	void filmstrip();
+	void gridView();
+	void layoutStrip();
+	void thumbActivated(const QModelIndex &index);
+	void thumbReady(QString path);      // Shows the thumbnail [preview] was waiting on
+
+	void recursive(bool on);            // List subdirectories of [path] too, down to [max_depth]
+	void tracing(bool on);              // Start or stop recording trace points, with the timing overlay
+	void exportTrace();
+	void updateTimings();
+	void memoryUsage(bool on);          // Show or hide the [Governor] readout
+	void updateMemory();
+
+	void scanned(int scan, FileBatch b);    // Batches from [scanner] as the directory is listed
+	void scanFinished(int scan, size_t total);
+	void scanFailed(int scan, QString message);
+
+	void videoLooper(QMediaPlayer::MediaStatus status);    // For looping mp4 videos
     
 	void firs();
 	void prev();
 	void delt();
 	void next();
 	void last();
+	void undo();
 
 private:
 	fs::path path;
-	std::vector<fs::path> files;
+	FileList files;
 	int cidx = -1;
+	DirWatcher* watcher;
+	DirScanner* scanner;
+	Trash* trash;
+	int scanning = -1;                  // Id of the [scanner] listing that feeds [files]
+	size_t scan_idx = 0;                // Position to select once the listing is complete
+	fs::path indexed;                   // Directory [files] is a listing of
+	bool listed = false;                // [files] holds all of [indexed], not a partial scan
+	uint64_t indexed_revision = 0;      // [files] as of the last [saveIndex]
+	uint64_t indexed_probes = 0;
+	QTimer* index_timer;
 
 	QString sorting = "Modified";
-	std::string filter = "(";
 
 	PicoWidget* w;
 	QPalette palette;
@@ -119,19 +191,44 @@ private:
 
 	QPushButton* _refr;
 	QPushButton* _fullscreen;
-	QLabel* img_container;
+	PicoCanvas* img_container;
 	
-	QMovie* mov;
-	QImage img;
+	Animation* anim;
+	QElapsedTimer startup;              // Valid only while measuring startup
+	Loader* loader;
+	int pending = -1;                   // Id of the outstanding [loader] request, -1 if none
+	int direction = 1;                  // Direction of travel through [files], +1 or -1
+	int lookahead = 3;                  // Read-ahead depth in the direction of travel
+	int lookbehind = 1;                 // Read-ahead depth against the direction of travel
+	int hintahead = 8;                  // Files past [lookahead] the kernel is asked to read in
+
+	QTimer* nav_timer;                  // Loads the full image once key repeat stops
+	QElapsedTimer nav_clock;            // Since the last [step]
+	bool previewing = false;            // Only a preview of [cidx] is up
+	static const int repeat_interval = 150;    // Milliseconds, steps closer together than this are key repeat
+	bool still = false;                 // [img_container] holds a decoded still image of [files[cidx]]
+	QTimer* resize_timer;
 	QWidget* vid_container;
-	QVideoWidget* vid;
-	QMediaPlayer* player;
+	QVideoWidget* vid = nullptr;
+	QMediaPlayer* player = nullptr;
 	QRect img_rect;
 	QSize label_size;
-	int nframes;
+
+	ThumbCache* thumbs;
+	ThumbModel* thumb_model;
+	QListView* strip;                   // Filmstrip below the media, or the whole grid
+	bool show_strip = false;
+	bool show_grid = false;
+
+	int depth = 0;                      // Levels of subdirectories listed along with [path]
+	int max_depth = 8;                  // [depth] when recursive, negative for no limit. PICOVIEW_DEPTH overrides
 
 	QLabel* info;
 	QLabel* dimensions;	
+	QLabel* timings;                    // Last decode/scale/present times, shown while tracing
+	QLabel* memory;                     // Memory in use against the cap, see [memoryUsage]
+	QTimer* memory_timer;
+	QLabel* count;
 
 	QPushButton* _next;
 	QPushButton* _delt;
@@ -143,8 +240,18 @@ private:
 	std::vector<void (PicoView::*)()> _controls_slots = {&PicoView::firs, &PicoView::prev, &PicoView::delt, &PicoView::next, &PicoView::last};
 
 	QMenu* file;
-	std::vector<std::string> _file_actions = {"Open File...", "Open Directory..."};
-	std::vector<void (PicoView::*)()> _file_slots = {&PicoView::open_file, &PicoView::open_dir};
+	std::vector<std::string> _file_actions = {"Open File...", "Open Directory...", "Export Trace..."};
+	std::vector<void (PicoView::*)()> _file_slots = {&PicoView::open_file, &PicoView::open_dir, &PicoView::exportTrace};
+
+	QMenu* view;
+	QAction* _filmstrip;
+	QAction* _grid;
+	QAction* _recursive;
+	QAction* _tracing;
+	QAction* _memory;
+	std::vector<std::string> _view_actions = {"Zoom In", "Zoom Out", "Fit to Window", "Actual Size"};
+	std::vector<QKeySequence> _view_keys = {QKeySequence(QKeySequence::ZoomIn), QKeySequence(QKeySequence::ZoomOut), QKeySequence("Ctrl+0"), QKeySequence("Ctrl+1")};
+	std::vector<void (PicoCanvas::*)()> _view_slots = {&PicoCanvas::zoomIn, &PicoCanvas::zoomOut, &PicoCanvas::zoomFit, &PicoCanvas::zoomActual};
 
 	QMenu* sort;
 	std::map<std::string, SortMode> _sort_options = {{"Name", name},
@@ -175,9 +282,3 @@ std::string tolower(const std::string &s);
 void setLabelText(QLabel* label, QString text);
 
 void error(const std::string mess, const int line, const char* file);
-
-template <typename T>
-void split(const std::string &s, char delim, T result);
-QSize split(const std::string &s, char delim);
-
-std::string exec(std::string command);
@@ -0,0 +1,10 @@
+# Viewer sources shared by the application and the benchmarks
+QT = core gui widgets multimediawidgets multimedia
+CONFIG += debug c++14
+LIBS += -lstdc++fs
+INCLUDEPATH += $$PWD
+
+SOURCES += $$PWD/picoview.c++ $$PWD/loader.c++ $$PWD/cache.c++ $$PWD/canvas.c++ $$PWD/filelist.c++ $$PWD/watcher.c++ $$PWD/media.c++ $$PWD/scanner.c++ $$PWD/thumbs.c++ $$PWD/index.c++ $$PWD/trace.c++ $$PWD/scale.c++ $$PWD/animation.c++ $$PWD/trash.c++ $$PWD/mapped.c++ $$PWD/exif.c++ $$PWD/governor.c++
+HEADERS += $$PWD/picoview.h $$PWD/loader.h $$PWD/cache.h $$PWD/canvas.h $$PWD/filelist.h $$PWD/watcher.h $$PWD/media.h $$PWD/scanner.h $$PWD/thumbs.h $$PWD/index.h $$PWD/trace.h $$PWD/scale.h $$PWD/animation.h $$PWD/trash.h $$PWD/mapped.h $$PWD/exif.h $$PWD/governor.h
+
+RESOURCES += $$PWD/picoview.qrc
@@ -1,12 +1,8 @@
-TEMPLATE = app
-TARGET = ~/bin/picoview
-
-QT = core gui widgets multimediawidgets multimedia
-CONFIG += debug
-LIBS += -lstdc++fs
-
-SOURCES += main.c++ picoview.c++
-HEADERS += picoview.h
-
-RESOURCES += picoview.qrc
-
+TEMPLATE = subdirs
+
+# The viewer itself and the headless benchmarks, built from the same sources (picoview.pri),
+# and the tests, run with `make check`
+SUBDIRS = viewer bench tests
+viewer.file = viewer.pro
+bench.file = bench/picoview_bench.pro
+tests.file = tests/tests.pro
@@ -0,0 +1,241 @@
+/*
+ * scale.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Area-averaging downscaler for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCALE_X86
+#endif
+
+// Qt
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include "scale.h"
+
+namespace scale {
+
+namespace {
+
+// Sources with at least this many pixels are split across threads
+const size_t parallel_pixels = 4 << 20;
+
+// Contributions to each output pixel along one axis: source indices
+// [first, first + count) with the matching weights from [start]
+struct Axis {
+	std::vector<int> first;
+	std::vector<int> count;
+	std::vector<int> start;
+	std::vector<float> weights;
+};
+
+Axis axis(int from, int to) {
+	Axis a;
+	double r = (double)from / to;
+	for (int ii = 0; ii < to; ii ++) {
+		double lo = ii * r, hi = (ii + 1) * r;
+		int first = (int)lo, last = std::min(from, (int)std::ceil(hi));
+		a.first.push_back(first);
+		a.count.push_back(last - first);
+		a.start.push_back(a.weights.size());
+		for (int jj = first; jj < last; jj ++) {
+			// Fraction of source pixel {jj} covered by the output pixel, normalised
+			double w = std::min<double>(jj + 1, hi) - std::max<double>(jj, lo);
+			a.weights.push_back(float(w / r));
+		}
+	}
+	return a;
+}
+
+// Weighted sum of {n} source rows into {acc}, {len} channel values wide
+typedef void (*Vertical)(const uint8_t* const* rows, const float* w, int n, float* acc, int len);
+
+// Weighted sums along each row of {acc} into {dw} 32-bit pixels
+typedef void (*Horizontal)(const float* acc, const Axis &h, uint32_t* out, int dw);
+
+void verticalScalar(const uint8_t* const* rows, const float* w, int n, float* acc, int len) {
+	for (int ii = 0; ii < len; ii ++) acc[ii] = rows[0][ii] * w[0];
+	for (int k = 1; k < n; k ++) {
+		for (int ii = 0; ii < len; ii ++) acc[ii] += rows[k][ii] * w[k];
+	}
+}
+
+void horizontalScalar(const float* acc, const Axis &h, uint32_t* out, int dw) {
+	for (int x = 0; x < dw; x ++) {
+		const float* p = acc + h.first[x] * 4;
+		const float* w = h.weights.data() + h.start[x];
+		float sum[4] = {0, 0, 0, 0};
+		for (int k = 0; k < h.count[x]; k ++) {
+			for (int c = 0; c < 4; c ++) sum[c] += p[k * 4 + c] * w[k];
+		}
+		// Round half to even, as _mm_cvtps_epi32 does, so every kernel gives the same pixels
+		uint8_t px[4];
+		for (int c = 0; c < 4; c ++) px[c] = (uint8_t)std::min(255L, std::max(0L, std::lrint(sum[c])));
+		memcpy(out + x, px, 4);
+	}
+}
+
+#ifdef SCALE_X86
+__attribute__((target("sse4.1")))
+void verticalSse4(const uint8_t* const* rows, const float* w, int n, float* acc, int len) {
+	int ii = 0;
+	for (; ii + 4 <= len; ii += 4) {
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < n; k ++) {
+			int32_t b;
+			memcpy(&b, rows[k] + ii, 4);
+			__m128 v = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(b)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(v, _mm_set1_ps(w[k])));
+		}
+		_mm_storeu_ps(acc + ii, sum);
+	}
+	for (; ii < len; ii ++) {
+		acc[ii] = 0;
+		for (int k = 0; k < n; k ++) acc[ii] += rows[k][ii] * w[k];
+	}
+}
+
+// One pixel's four channels per register
+__attribute__((target("sse4.1")))
+void horizontalSse4(const float* acc, const Axis &h, uint32_t* out, int dw) {
+	for (int x = 0; x < dw; x ++) {
+		const float* p = acc + h.first[x] * 4;
+		const float* w = h.weights.data() + h.start[x];
+		__m128 sum = _mm_setzero_ps();
+		for (int k = 0; k < h.count[x]; k ++) sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p + k * 4), _mm_set1_ps(w[k])));
+		__m128i v = _mm_cvtps_epi32(sum);
+		v = _mm_packus_epi32(v, v);
+		v = _mm_packus_epi16(v, v);
+		out[x] = (uint32_t)_mm_cvtsi128_si32(v);
+	}
+}
+
+__attribute__((target("avx2")))
+void verticalAvx2(const uint8_t* const* rows, const float* w, int n, float* acc, int len) {
+	int ii = 0;
+	for (; ii + 8 <= len; ii += 8) {
+		__m256 sum = _mm256_setzero_ps();
+		for (int k = 0; k < n; k ++) {
+			__m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows[k] + ii));
+			__m256 v = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(v, _mm256_set1_ps(w[k])));
+		}
+		_mm256_storeu_ps(acc + ii, sum);
+	}
+	for (; ii < len; ii ++) {
+		acc[ii] = 0;
+		for (int k = 0; k < n; k ++) acc[ii] += rows[k][ii] * w[k];
+	}
+}
+#endif
+
+struct Kernels {
+	const char* name;
+	Vertical vertical;
+	Horizontal horizontal;
+};
+
+Kernels pick() {
+#ifdef SCALE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return {"avx2", verticalAvx2, horizontalSse4};
+	if (__builtin_cpu_supports("sse4.1")) return {"sse4.1", verticalSse4, horizontalSse4};
+#endif
+	return {"scalar", verticalScalar, horizontalScalar};
+}
+
+const Kernels &kernels() {
+	static const Kernels k = pick();
+	return k;
+}
+
+// Output rows [y0, y1) of {dst}: each one a vertical pass over its source rows, then a horizontal one
+void band(const QImage &src, uint8_t* out, int bpl, const Axis &h, const Axis &v, int y0, int y1) {
+	const Kernels &k = kernels();
+	std::vector<float> acc(size_t(src.width()) * 4);
+	std::vector<const uint8_t*> rows;
+	for (int y = y0; y < y1; y ++) {
+		rows.clear();
+		for (int jj = 0; jj < v.count[y]; jj ++) rows.push_back(src.constScanLine(v.first[y] + jj));
+		k.vertical(rows.data(), v.weights.data() + v.start[y], v.count[y], acc.data(), acc.size());
+		k.horizontal(acc.data(), h, reinterpret_cast<uint32_t*>(out + size_t(bpl) * y), int(h.first.size()));
+	}
+}
+
+class BandTask : public QRunnable {
+public:
+	BandTask(const QImage &_src, uint8_t* _out, int _bpl, const Axis &_h, const Axis &_v, int _y0, int _y1, QSemaphore &_done) :
+		src(_src), out(_out), bpl(_bpl), h(_h), v(_v), y0(_y0), y1(_y1), done(_done) {}
+
+	void run() override {
+		band(src, out, bpl, h, v, y0, y1);
+		done.release();
+	}
+
+private:
+	const QImage &src;
+	uint8_t* out;
+	int bpl;
+	const Axis &h;
+	const Axis &v;
+	int y0;
+	int y1;
+	QSemaphore &done;
+};
+
+}
+
+QImage downscale(const QImage &image, const QSize &target) {
+	if (image.isNull() || target.isEmpty()) return QImage();
+	if (target == image.size()) return image;
+	if (target.width() > image.width() || target.height() > image.height()) {
+		return image.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	}
+
+	// Averaging is only correct on premultiplied channels, opaque images skip the alpha entirely
+	QImage::Format f = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+	const QImage src = image.convertToFormat(f);
+	QImage dst(target, f);
+	if (dst.isNull()) return dst;
+
+	Axis h = axis(src.width(), target.width());
+	Axis v = axis(src.height(), target.height());
+
+	// Bands of at least 16 output rows, the caller takes the first. Rows are written through
+	// [bits] taken up front, so no thread ever detaches {dst}
+	uint8_t* out = dst.bits();
+	int bpl = dst.bytesPerLine();
+	int bands = 1;
+	if (size_t(src.width()) * src.height() >= parallel_pixels) {
+		bands = std::max(1, std::min(QThread::idealThreadCount(), target.height() / 16));
+	}
+	QSemaphore done;
+	for (int b = 1; b < bands; b ++) {
+		int y0 = target.height() * b / bands, y1 = target.height() * (b + 1) / bands;
+		QThreadPool::globalInstance()->start(new BandTask(src, out, bpl, h, v, y0, y1, done));
+	}
+	band(src, out, bpl, h, v, 0, target.height() / bands);
+	done.acquire(bands - 1);
+	return dst;
+}
+
+const char* kernel() {
+	return kernels().name;
+}
+
+}
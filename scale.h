@@ -0,0 +1,29 @@
+/*
+ * scale.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Area-averaging downscaler for PicoView minimal image viewer. Works on
+ * 32-bit pixels with AVX2 or SSE4.1 kernels picked at runtime (scalar
+ * elsewhere) and splits very large sources across threads by rows
+ *
+ */
+
+#pragma once
+
+// Qt
+#include <QImage>
+#include <QSize>
+
+namespace scale {
+
+// Shrink {src} to exactly {target}, every output pixel the coverage-weighted average of the
+// source pixels under it. Opaque images come back as RGB32, others as ARGB32_Premultiplied.
+// A {target} larger than {src} in either dimension falls back to Qt's smooth scaling
+QImage downscale(const QImage &src, const QSize &target);
+
+// Kernel chosen for this CPU: "avx2", "sse4.1" or "scalar"
+const char* kernel();
+
+}
@@ -0,0 +1,252 @@
+/*
+ * scanner.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Background directory enumeration for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <set>
+#include <utility>
+
+// Qt
+#include <QMutex>
+#include <QRunnable>
+#include <QThread>
+#include <QWaitCondition>
+
+// POSIX
+#include <sys/stat.h>
+
+#include "picoview.h"
+#include "scanner.h"
+#include "trash.h"
+
+// Batches entries for one emitter: small batches first so something shows at once, then
+// growing ones so merging stays cheap
+class Feed {
+public:
+	Feed(DirScanner* _scanner, int _generation) : scanner(_scanner), generation(_generation), last(clock::now()) {}
+
+	void add(FileEntry e) {
+		b.push_back(std::move(e));
+		if (b.size() >= std::max<size_t>(64, total / 4) || clock::now() - last > std::chrono::milliseconds(100)) flush();
+	}
+	void flush() {
+		if (b.empty() || !scanner->isCurrent(generation)) return;
+		total += b.size();
+		emit scanner->batch(generation, b);
+		b.clear();
+		last = clock::now();
+	}
+	size_t sent() const { return total; }
+
+private:
+	using clock = std::chrono::steady_clock;
+	DirScanner* scanner;
+	int generation;
+	FileBatch b;
+	size_t total = 0;
+	clock::time_point last;
+};
+
+class ScanTask : public QRunnable {
+public:
+	ScanTask(DirScanner* _scanner, int _generation, const fs::path &_dir) :
+		scanner(_scanner), generation(_generation), dir(_dir) {}
+
+	void run() override {
+		Feed feed(scanner, generation);
+		const std::unordered_set<std::string> &exts = supportedFormats();
+
+		try {
+			for (const auto &e : fs::directory_iterator(dir)) {
+				if (!scanner->isCurrent(generation)) break;
+
+				const fs::path &p = e.path();
+				std::string ext = tolower(p.extension().string());
+				if (!exts.count(ext)) continue;
+				feed.add(FileEntry::stat(p, ext));
+			}
+		}
+		catch (const fs::filesystem_error &e) {
+			emit scanner->failed(generation, QString::fromStdString(e.what()));
+		}
+		feed.flush();
+
+		// No longer running by the time [finished] is handled
+		scanner->running --;
+		if (scanner->isCurrent(generation)) emit scanner->finished(generation, feed.sent());
+	}
+
+private:
+	DirScanner* scanner;
+	int generation;
+	fs::path dir;
+};
+
+// Shared state of one recursive scan. Each worker owns a lane of directories, taking the
+// newest from its own and, once that runs dry, stealing the oldest from someone else's
+struct Walk {
+	struct Lane {
+		QMutex mutex;
+		std::deque<std::pair<fs::path, int>> dirs;  // With their depth below the root
+	};
+
+	DirScanner* scanner;
+	int generation;
+	int depth;                          // Deepest level listed, negative for no limit
+	std::vector<std::unique_ptr<Lane>> lanes;
+	std::atomic<int> outstanding{0};    // Directories queued or being listed
+	std::atomic<int> queued{0};         // Directories waiting in [lanes]
+	std::atomic<int> workers{0};
+	std::atomic<size_t> total{0};
+
+	// Workers with nothing to take sleep on [work] until directories are queued or the walk ends
+	QMutex idle_mutex;
+	QWaitCondition work;
+
+	void wake() {
+		QMutexLocker lock(&idle_mutex);
+		work.wakeAll();
+	}
+
+	// Directories already taken, by device and inode, so symlinks can't lead around in circles
+	QMutex seen_mutex;
+	std::set<std::pair<dev_t, ino_t>> seen;
+
+	bool visit(const fs::path &dir) {
+		struct stat st;
+		if (::stat(dir.c_str(), &st) != 0) return false;
+		QMutexLocker lock(&seen_mutex);
+		return seen.insert({st.st_dev, st.st_ino}).second;
+	}
+};
+
+class WalkTask : public QRunnable {
+public:
+	WalkTask(std::shared_ptr<Walk> _walk, size_t _lane) : walk(_walk), lane(_lane) {}
+
+	void run() override {
+		Feed feed(walk->scanner, walk->generation);
+		std::pair<fs::path, int> d;
+		while (walk->scanner->isCurrent(walk->generation)) {
+			if (take(d)) {
+				list(d.first, d.second, feed);
+				if (--walk->outstanding == 0) walk->wake();
+				continue;
+			}
+
+			// Nothing to take, hand over what's been found before going idle. [queued] is raised
+			// before [wake] takes the lock, so checking it under the lock can't miss a wake-up,
+			// the timeout only notices a cancelled scan
+			feed.flush();
+			QMutexLocker lock(&walk->idle_mutex);
+			if (walk->outstanding.load() == 0) break;
+			if (walk->queued.load() == 0) walk->work.wait(&walk->idle_mutex, 100);
+		}
+		feed.flush();
+		walk->total += feed.sent();
+
+		// The last worker out reports for the whole walk
+		if (--walk->workers == 0) {
+			walk->scanner->running --;
+			if (walk->scanner->isCurrent(walk->generation)) emit walk->scanner->finished(walk->generation, walk->total.load());
+		}
+	}
+
+private:
+	bool take(std::pair<fs::path, int> &d) {
+		size_t n = walk->lanes.size();
+		for (size_t ii = 0; ii < n; ii ++) {
+			Walk::Lane &l = *walk->lanes[(lane + ii) % n];
+			QMutexLocker lock(&l.mutex);
+			if (l.dirs.empty()) continue;
+			if (ii == 0) {
+				d = l.dirs.back();
+				l.dirs.pop_back();
+			}
+			else {
+				d = l.dirs.front();
+				l.dirs.pop_front();
+			}
+			walk->queued --;
+			return true;
+		}
+		return false;
+	}
+
+	void list(const fs::path &dir, int level, Feed &feed) {
+		const std::unordered_set<std::string> &exts = supportedFormats();
+		bool deeper = walk->depth < 0 || level < walk->depth;
+		std::vector<std::pair<fs::path, int>> found;
+		std::error_code ec;
+		for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+			if (!walk->scanner->isCurrent(walk->generation)) return;
+			const fs::path &p = it->path();
+
+			// Follows symlinks, [visit] keeps that from looping
+			std::error_code sc;
+			if (fs::is_directory(it->status(sc))) {
+				if (deeper && p.filename() != Trash::name && walk->visit(p)) found.push_back({p, level + 1});
+				continue;
+			}
+			std::string ext = tolower(p.extension().string());
+			if (!exts.count(ext)) continue;
+			feed.add(FileEntry::stat(p, ext));
+		}
+		if (ec && level == 0) emit walk->scanner->failed(walk->generation, QString::fromStdString(ec.message()));
+		if (found.empty()) return;
+
+		walk->outstanding += int(found.size());
+		{
+			Walk::Lane &l = *walk->lanes[lane];
+			QMutexLocker lock(&l.mutex);
+			for (auto &f : found) l.dirs.push_back(std::move(f));
+		}
+		walk->queued += int(found.size());
+		walk->wake();
+	}
+
+	std::shared_ptr<Walk> walk;
+	size_t lane;
+};
+
+DirScanner::DirScanner(QObject* parent) : QObject(parent), generation(0), running(0) {
+	qRegisterMetaType<FileBatch>("FileBatch");
+	qRegisterMetaType<size_t>("size_t");
+}
+DirScanner::~DirScanner() {
+	cancel();
+	pool.waitForDone();
+}
+
+int DirScanner::scan(const fs::path &dir, int depth) {
+	int g = ++generation;
+	running ++;
+	if (depth == 0) {
+		pool.start(new ScanTask(this, g, dir));
+		return g;
+	}
+
+	std::shared_ptr<Walk> walk = std::make_shared<Walk>();
+	walk->scanner = this;
+	walk->generation = g;
+	walk->depth = depth;
+	int n = std::max(1, QThread::idealThreadCount());
+	for (int ii = 0; ii < n; ii ++) walk->lanes.emplace_back(new Walk::Lane);
+	walk->visit(dir);
+	walk->lanes[0]->dirs.push_back({dir, 0});
+	walk->outstanding = 1;
+	walk->queued = 1;
+	walk->workers = n;
+	for (int ii = 0; ii < n; ii ++) pool.start(new WalkTask(walk, ii));
+	return g;
+}
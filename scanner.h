@@ -0,0 +1,63 @@
+/*
+ * scanner.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Background directory enumeration for PicoView minimal image
+ * viewer, lists and stats a directory on a worker thread and
+ * streams the entries back to the GUI thread in growing batches
+ *
+ */
+
+#pragma once
+
+// std
+#include <atomic>
+#include <experimental/filesystem>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Qt
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include "filelist.h"
+
+namespace fs = std::experimental::filesystem;
+
+typedef std::vector<FileEntry> FileBatch;
+Q_DECLARE_METATYPE(FileBatch)
+
+class DirScanner : public QObject {
+	Q_OBJECT
+
+public:
+	DirScanner(QObject* parent = Q_NULLPTR);
+	~DirScanner();
+
+	// Start listing {dir}, keeping entries in one of the [supportedFormats]. A nonzero
+	// {depth} also lists that many levels of subdirectories (all of them if negative),
+	// walked in parallel. Any scan still running is abandoned. Returns the scan's id
+	int scan(const fs::path &dir, int depth = 0);
+	void cancel() { ++generation; }
+
+	bool isCurrent(int g) const { return g == generation.load(); }
+	bool isScanning() const { return running.load() > 0; }
+
+signals:
+	void batch(int scan, FileBatch entries);
+	void finished(int scan, size_t total);
+	void failed(int scan, QString message);
+
+private:
+	friend class ScanTask;
+	friend class WalkTask;
+
+	QThreadPool pool;
+	std::atomic<int> generation;
+	std::atomic<int> running;
+};
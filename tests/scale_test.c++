@@ -0,0 +1,104 @@
+/*
+ * scale_test.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Cross-check of the downscaler's kernels for PicoView minimal image
+ * viewer. Every kernel this CPU can run has to give the same bits as
+ * the scalar one, or output would depend on the machine
+ *
+ */
+
+// std
+#include <cstdio>
+#include <random>
+
+// The kernels live in an anonymous namespace, so the test is built with them
+#include "../scale.c++"
+
+using namespace scale;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+	if (ok) return;
+	fprintf(stderr, "FAIL: %s\n", what);
+	failures ++;
+}
+
+// Weights of {n} rows summing to one, as [axis] produces them
+static std::vector<float> weights(std::mt19937 &rng, int n) {
+	std::vector<float> w(n);
+	float total = 0;
+	for (auto &v : w) total += v = std::uniform_real_distribution<float>(0.05f, 1)(rng);
+	for (auto &v : w) v /= total;
+	return w;
+}
+
+static void vertical(std::mt19937 &rng, Vertical kernel, const char* name) {
+	for (int trial = 0; trial < 200; trial ++) {
+		int n = 1 + rng() % 6, len = 4 * (1 + rng() % 67);
+		std::vector<std::vector<uint8_t>> data(n, std::vector<uint8_t>(len));
+		std::vector<const uint8_t*> rows;
+		for (auto &r : data) {
+			for (auto &b : r) b = rng();
+			rows.push_back(r.data());
+		}
+		std::vector<float> w = weights(rng, n);
+		std::vector<float> expect(len), got(len);
+		verticalScalar(rows.data(), w.data(), n, expect.data(), len);
+		kernel(rows.data(), w.data(), n, got.data(), len);
+		if (memcmp(expect.data(), got.data(), len * sizeof(float))) {
+			check(false, name);
+			return;
+		}
+	}
+}
+
+static void horizontal(std::mt19937 &rng, Horizontal kernel, const char* name) {
+	for (int trial = 0; trial < 200; trial ++) {
+		int from = 2 + rng() % 300, to = 1 + rng() % from;
+		Axis h = axis(from, to);
+		std::vector<float> acc(size_t(from) * 4);
+		for (auto &v : acc) v = float(rng() % 256) + (rng() % 4) * 0.25f;
+		std::vector<uint32_t> expect(to), got(to);
+		horizontalScalar(acc.data(), h, expect.data(), to);
+		kernel(acc.data(), h, got.data(), to);
+		if (memcmp(expect.data(), got.data(), to * sizeof(uint32_t))) {
+			check(false, name);
+			return;
+		}
+	}
+}
+
+int main() {
+	std::mt19937 rng(17);
+
+	// A 2x reduction of {2, 2, 3, 3} lands exactly on 2.5, which rounds to even
+	{
+		Axis h = axis(2, 1);
+		float acc[8] = {2, 2, 2, 2, 3, 3, 3, 3};
+		uint32_t out = 0;
+		horizontalScalar(acc, h, &out, 1);
+		check(out == 0x02020202, "scalar rounds half to even");
+	}
+
+#ifdef SCALE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.1")) {
+		vertical(rng, verticalSse4, "sse4.1 vertical matches scalar");
+		horizontal(rng, horizontalSse4, "sse4.1 horizontal matches scalar");
+
+		Axis h = axis(2, 1);
+		float acc[8] = {2, 2, 2, 2, 3, 3, 3, 3};
+		uint32_t out = 0;
+		horizontalSse4(acc, h, &out, 1);
+		check(out == 0x02020202, "sse4.1 rounds half to even");
+	}
+	if (__builtin_cpu_supports("avx2")) vertical(rng, verticalAvx2, "avx2 vertical matches scalar");
+#endif
+
+	printf("%s: %s kernel, %d failure%s\n", failures ? "FAIL" : "PASS", kernel(), failures, failures == 1 ? "" : "s");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = scale_test
+
+# Includes ../scale.c++ itself, the kernels aren't visible outside it. `make check` runs it
+QT = core gui
+CONFIG += debug c++14 console testcase
+CONFIG -= app_bundle
+INCLUDEPATH += $$PWD/..
+
+SOURCES += scale_test.c++
+HEADERS += ../scale.h
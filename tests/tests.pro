@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+# Each test is a program of its own, `make check` runs them all
+SUBDIRS = scale_test view_test
+scale_test.file = scale_test.pro
+view_test.file = view_test.pro
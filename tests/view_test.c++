@@ -0,0 +1,110 @@
+/*
+ * view_test.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Checks of the viewer's listing behaviour for PicoView minimal image
+ * viewer, driven offscreen against small generated directories
+ *
+ */
+
+// std
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+// Qt
+#include <QTemporaryDir>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "picoview.h"
+
+class ViewTest {
+public:
+	ViewTest(PicoView &_view) : view(_view) {}
+
+	int run(const fs::path &root);
+
+private:
+	void check(bool ok, const char* what);
+	void listed();                      // Wait for [view] to have the whole directory
+
+	PicoView &view;
+	int failures = 0;
+};
+
+// Small PNG at {p}, modified {age} seconds ago
+static void image(const fs::path &p, int age) {
+	QImage img(8, 8, QImage::Format_RGB32);
+	img.fill(QColor(age * 10 % 255, 80, 160));
+	img.save(QString::fromStdString(p.string()), "PNG");
+	struct timespec t[2];
+	clock_gettime(CLOCK_REALTIME, &t[0]);
+	t[0].tv_sec -= age;
+	t[1] = t[0];
+	utimensat(AT_FDCWD, p.c_str(), t, 0);
+}
+
+int ViewTest::run(const fs::path &root) {
+	// Names in the opposite order to their mtimes, so name order can't pass for modified order
+	fs::path dir = root / "modified";
+	fs::create_directories(dir);
+	const std::vector<std::string> names = {"a.png", "b.png", "c.png", "d.png", "e.png"};
+	for (size_t ii = 0; ii < names.size(); ii ++) image(dir / names[ii], int(ii) * 60);
+
+	// Nothing is indexed yet, so the listing is streamed from the scanner
+	view.open(dir);
+	listed();
+	check(view.sorting == "Modified", "the default sort is Modified");
+	check(view.files.mode() == SortMode::modified, "a streamed listing is in the list's Modified mode");
+	check(view.files.size() == names.size(), "every file is listed");
+	bool ordered = view.files.size() == names.size();
+	for (size_t ii = 0; ordered && ii < names.size(); ii ++) {
+		ordered = view.files[ii].path.filename() == names[names.size() - 1 - ii];
+	}
+	check(ordered, "a fresh streamed open comes out oldest first");
+
+	printf("%s: %d failure%s\n", failures ? "FAIL" : "PASS", failures, failures == 1 ? "" : "s");
+	return failures ? 1 : 0;
+}
+
+void ViewTest::check(bool ok, const char* what) {
+	if (ok) return;
+	fprintf(stderr, "FAIL: %s\n", what);
+	failures ++;
+}
+
+void ViewTest::listed() {
+	QElapsedTimer t;
+	t.start();
+	while (!view.listed && t.elapsed() < 10000) {
+		// [DirScanner::finished] is already queued once the scanner stops running
+		if (!view.scanner->isScanning()) {
+			QCoreApplication::processEvents();
+			break;
+		}
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 100);
+	}
+}
+
+int main(int argn, char** argv) {
+	// Nothing here needs a display
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	// Keep the thumbnail and index caches out of the user's, and cold on every run
+	QTemporaryDir scratch;
+	qputenv("XDG_CACHE_HOME", QString(scratch.path()+"/cache").toLocal8Bit());
+
+	QApplication a(argn, argv);
+	QPalette palette;
+	PicoView w(palette);
+	w.resize(800, 600);
+	w.show();
+
+	ViewTest test(w);
+	return test.run(fs::path(scratch.path().toStdString()));
+}
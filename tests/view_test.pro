@@ -0,0 +1,9 @@
+TEMPLATE = app
+TARGET = view_test
+
+# Drives the viewer offscreen, like the benchmarks
+include(../picoview.pri)
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+SOURCES += view_test.c++
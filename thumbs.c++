@@ -0,0 +1,407 @@
+/*
+ * thumbs.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Persistent thumbnail cache for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <algorithm>
+#include <cstring>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Qt
+#include <QCryptographicHash>
+#include <QDir>
+#include <QRunnable>
+#include <QStandardPaths>
+#include <QThread>
+
+#include "cache.h"
+#include "exif.h"
+#include "loader.h"
+#include "scale.h"
+#include "thumbs.h"
+
+// Record layout in the pack: key, width, height, bytes per line, then pixels, padded to 8 bytes
+struct ThumbHeader {
+	uint64_t key;
+	uint16_t width;
+	uint16_t height;
+	uint32_t stride;
+};
+
+static size_t recordSize(const ThumbHeader &h) { return (sizeof(ThumbHeader) + size_t(h.stride) * h.height + 7) & ~size_t(7); }
+
+// Packs that outgrow this (stale thumbnails pile up as files change) are started over
+static const size_t pack_limit = size_t(1) << 30;
+
+// Address space each mapping of a pack reserves, a 1 GB pack takes at most 16 of them
+static const size_t map_window = size_t(64) << 20;
+
+class ThumbTask : public QRunnable {
+public:
+	// A {serial} of a [ThumbCache::preview] is dropped once a later one is made, -1 never is
+	ThumbTask(ThumbCache* _cache, int _generation, const FileEntry &_entry, int _serial = -1) :
+		cache(_cache), generation(_generation), entry(_entry), serial(_serial) {}
+
+	void run() override {
+		if (!cache->isCurrent(generation)) return;
+		ThumbCache* c = cache;
+		int s = serial;
+		Cancelled superseded = [c, s]() { return s >= 0 && s != c->previews.load(); };
+
+		// A camera file's embedded preview is a small JPEG already, otherwise a reduced decode
+		// straight to thumbnail size where the codec can do it
+		QSize box(ThumbCache::size, ThumbCache::size);
+		QImage image = superseded() ? QImage() : exif::preview(entry.path);
+		if (!image.isNull()) image = scale::downscale(image, ImageCache::fitted(image.size(), box));
+		else if (!superseded()) image = Loader::decode(entry.path, box, superseded).image;
+		if (superseded()) {
+			cache->abandon(ThumbCache::key(entry));
+			return;
+		}
+		QImage thumb = image.isNull() ? QImage() : image.convertToFormat(QImage::Format_RGB888);
+		cache->store(generation, ThumbCache::key(entry), thumb);
+		emit cache->ready(QString::fromStdString(entry.path.string()));
+	}
+
+private:
+	ThumbCache* cache;
+	int generation;
+	FileEntry entry;
+	int serial;
+};
+
+ThumbCache::ThumbCache(QObject* parent, QThreadPool* shared) : QObject(parent), generation(0), previews(0) {
+	owned = !shared;
+	pool = shared ? shared : new QThreadPool;
+	if (owned) pool->setMaxThreadCount(QThread::idealThreadCount());
+}
+ThumbCache::~ThumbCache() {
+	// Queued work on a shared pool isn't only this cache's to drop, it finishes as a no-op
+	++generation;
+	if (owned) pool->clear();
+	pool->waitForDone();
+	close();
+	if (owned) delete pool;
+}
+
+void ThumbCache::open(const fs::path &_dir) {
+	if (_dir == dir && fd >= 0) return;
+
+	// Workers still decoding for the old pack check [generation] before storing anything
+	++generation;
+	if (owned) pool->clear();
+	close();
+	dir = _dir;
+
+	QString root = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)+"/thumbs";
+	QDir().mkpath(root);
+	QByteArray name = QCryptographicHash::hash(QByteArray::fromStdString(dir.string()), QCryptographicHash::Sha1).toHex();
+	std::string pack = (root+"/"+name+".pack").toStdString();
+
+	QMutexLocker lock(&mutex);
+	for (;;) {
+		// Appends always land at the end of the file, whichever process wrote last
+		fd = ::open(pack.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (fd < 0) return;
+		if (flock(fd, LOCK_EX) != 0) {
+			::close(fd);
+			fd = -1;
+			return;
+		}
+
+		// Another instance may have replaced the pack while this one waited for the lock
+		struct stat st, named;
+		if (fstat(fd, &st) != 0 || ::stat(pack.c_str(), &named) != 0 || st.st_ino != named.st_ino || st.st_dev != named.st_dev) {
+			::close(fd);
+			continue;
+		}
+
+		// Other processes may have the pack mapped, so it is never cut short in place. One that
+		// has grown too large, or ends in a record whose writer died, is replaced by a new file
+		size_t size = st.st_size;
+		if (size > pack_limit) {
+			if (!replace(pack, 0)) return;
+			continue;
+		}
+		index(size);
+		if (end != size) {
+			if (!replace(pack, end)) return;
+			continue;
+		}
+		flock(fd, LOCK_UN);
+		return;
+	}
+}
+
+void ThumbCache::index(size_t size) {
+	// Every writer holds the lock, so whatever doesn't make a whole record here is a torn one
+	size_t at = end;
+	end = size;
+	const unsigned char* data = size > at ? locate(at, size - at) : nullptr;
+	const unsigned char* base = data ? data - at : nullptr;
+	while (data && at + sizeof(ThumbHeader) <= size) {
+		ThumbHeader h;
+		memcpy(&h, base + at, sizeof(h));
+		if (at + recordSize(h) > size || h.stride < size_t(h.width) * 3) break;
+		records[h.key] = at;
+		at += recordSize(h);
+	}
+	end = at;
+}
+
+bool ThumbCache::replace(const std::string &pack, size_t keep) {
+	// Copy the first {keep} bytes to a file of our own and rename it over the pack, then let
+	// [open] start again on it. Called holding the lock on [fd], which is closed either way
+	std::string temp = pack+"."+std::to_string(getpid())+".tmp";
+	int out = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	bool ok = out >= 0;
+	const unsigned char* data = keep ? locate(0, keep) : nullptr;
+	if (ok && keep) ok = data && ::write(out, data, keep) == ssize_t(keep);
+	if (out >= 0) ::close(out);
+	if (ok) ok = rename(temp.c_str(), pack.c_str()) == 0;
+	if (!ok) unlink(temp.c_str());
+
+	for (const auto &r : regions) munmap(r.data, r.length);
+	regions.clear();
+	records.clear();
+	end = 0;
+	::close(fd);
+	fd = -1;
+	return ok;
+}
+
+void ThumbCache::close() {
+	QMutexLocker lock(&mutex);
+	for (const auto &r : regions) munmap(r.data, r.length);
+	regions.clear();
+	records.clear();
+	in_flight.clear();
+	failed.clear();
+	if (fd >= 0) ::close(fd);
+	fd = -1;
+	end = 0;
+}
+
+QImage ThumbCache::find(const FileEntry &e) {
+	QMutexLocker lock(&mutex);
+	auto found = records.find(key(e));
+	if (found == records.end()) return QImage();
+
+	const unsigned char* data = locate(found->second, sizeof(ThumbHeader));
+	if (!data) return QImage();
+	ThumbHeader h;
+	memcpy(&h, data, sizeof(h));
+	data = locate(found->second, recordSize(h));
+	if (!data) return QImage();
+	// Never show another file's thumbnail, whatever else has written to the pack
+	if (h.key != found->first) return QImage();
+	return QImage(data + sizeof(ThumbHeader), h.width, h.height, h.stride, QImage::Format_RGB888);
+}
+
+void ThumbCache::request(const FileEntry &e) {
+	uint64_t k = key(e);
+	{
+		QMutexLocker lock(&mutex);
+		if (fd < 0 || records.count(k) || in_flight.count(k) || failed.count(k)) return;
+		in_flight.insert(k);
+	}
+	pool->start(new ThumbTask(this, generation, e));
+}
+
+void ThumbCache::preview(const FileEntry &e) {
+	int s = ++previews;
+	uint64_t k = key(e);
+	{
+		QMutexLocker lock(&mutex);
+		if (fd < 0 || records.count(k) || in_flight.count(k) || failed.count(k)) return;
+		in_flight.insert(k);
+	}
+	// Ahead of the grid's requests, it's what is on screen
+	pool->start(new ThumbTask(this, generation, e, s), 1);
+}
+
+void ThumbCache::abandon(uint64_t k) {
+	QMutexLocker lock(&mutex);
+	in_flight.erase(k);
+}
+
+uint64_t ThumbCache::key(const FileEntry &e) {
+	// FNV-1a over path, size and mtime
+	uint64_t h = 14695981039346656037ull;
+	auto mix = [&h](const void* p, size_t n) {
+		for (size_t ii = 0; ii < n; ii ++) {
+			h ^= static_cast<const unsigned char*>(p)[ii];
+			h *= 1099511628211ull;
+		}
+	};
+	const std::string &s = e.path.string();
+	mix(s.data(), s.size());
+	mix(&e.size, sizeof(e.size));
+	mix(&e.mtime, sizeof(e.mtime));
+	return h;
+}
+
+void ThumbCache::store(int g, uint64_t k, const QImage &thumb) {
+	QMutexLocker lock(&mutex);
+	if (!isCurrent(g)) return;
+	in_flight.erase(k);
+	if (thumb.isNull()) failed.insert(k);
+	if (fd < 0 || thumb.isNull()) return;
+
+	ThumbHeader h = {k, uint16_t(thumb.width()), uint16_t(thumb.height()), uint32_t(thumb.bytesPerLine())};
+	std::vector<unsigned char> record(recordSize(h), 0);
+	memcpy(record.data(), &h, sizeof(h));
+	memcpy(record.data() + sizeof(h), thumb.constBits(), size_t(h.stride) * h.height);
+
+	// Other instances append to the same pack, pick up their records before adding one
+	if (flock(fd, LOCK_EX) != 0) return;
+	struct stat st;
+	if (fstat(fd, &st) == 0) {
+		size_t size = st.st_size;
+		if (size > end) index(size);
+
+		// Behind a torn record nothing would be found again, leave it for the next [open]
+		if (end == size && ::write(fd, record.data(), record.size()) == ssize_t(record.size())) {
+			records[k] = end;
+			end += record.size();
+		}
+	}
+	flock(fd, LOCK_UN);
+}
+
+const unsigned char* ThumbCache::locate(size_t offset, size_t length) {
+	// Regions reach past the end of the file, only what's been indexed is there to read
+	if (offset + length > end) return nullptr;
+	for (const auto &r : regions) {
+		if (offset >= r.offset && offset + length <= r.offset + r.length) return r.data + (offset - r.offset);
+	}
+
+	// Map a window from the page holding {offset}, well past the end of the pack so the records
+	// appended after it land inside. Windows only overlap by the record that crossed the last
+	// one's end, and each is still what [find]'s images point into, so they all stay mapped
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t start = offset / page * page;
+	size_t length = std::max(end - start, map_window);
+	void* data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, start);
+	if (data == MAP_FAILED) return nullptr;
+	regions.push_back({start, length, static_cast<unsigned char*>(data)});
+	return regions.back().data + (offset - start);
+}
+
+// Model
+ThumbModel::ThumbModel(FileList* _files, ThumbCache* _cache, QObject* parent) :
+	QAbstractListModel(parent), files(_files), cache(_cache) {
+	placeholder = QImage(ThumbCache::size, ThumbCache::size * 2 / 3, QImage::Format_RGB888);
+	placeholder.fill(QColor(40, 40, 40));
+	revision = files->revision();
+	for (const auto &e : *files) rows.push_back(e.path);
+	connect(cache, &ThumbCache::ready, this, &ThumbModel::ready, Qt::QueuedConnection);
+}
+
+int ThumbModel::rowCount(const QModelIndex &parent) const {
+	return parent.isValid() ? 0 : rows.size();
+}
+
+QVariant ThumbModel::data(const QModelIndex &index, int role) const {
+	if (!index.isValid() || (size_t)index.row() >= rows.size()) return QVariant();
+	// Between [sync]s rows and [files] can disagree on positions, never on what's in a row
+	long i = files->indexOf(rows[index.row()]);
+	if (i < 0) return QVariant();
+	const FileEntry &e = (*files)[i];
+
+	if (role == Qt::DecorationRole) {
+		// Only rows the view actually paints get here, so generation follows the viewport
+		QImage thumb = cache->find(e);
+		if (!thumb.isNull()) return thumb;
+		if (e.ext != ".mp4") cache->request(e);
+		return placeholder;
+	}
+	if (role == Qt::ToolTipRole) return QString::fromStdString(e.path.filename().string());
+	return QVariant();
+}
+
+void ThumbModel::sync() {
+	if (files->revision() == revision) return;
+	revision = files->revision();
+
+	std::vector<fs::path> now;
+	std::unordered_set<std::string> before, after;
+	now.reserve(files->size());
+	for (const auto &e : *files) {
+		now.push_back(e.path);
+		after.insert(e.path.string());
+	}
+	for (const auto &p : rows) before.insert(p.string());
+
+	// Same files in another order, the view keeps its selection through the layout change
+	if (before == after) {
+		emit layoutAboutToBeChanged();
+		std::unordered_map<std::string, int> moved;
+		for (size_t ii = 0; ii < now.size(); ii ++) moved[now[ii].string()] = ii;
+		QModelIndexList from = persistentIndexList(), to;
+		for (const auto &i : from) to << index(moved[rows[i.row()].string()]);
+		changePersistentIndexList(from, to);
+		rows = std::move(now);
+		emit layoutChanged();
+		return;
+	}
+
+	// What stayed has to be in the same order for the rest to be rows removed and inserted
+	std::vector<const fs::path*> kept, merged;
+	for (const auto &p : rows) {
+		if (after.count(p.string())) kept.push_back(&p);
+	}
+	for (const auto &p : now) {
+		if (before.count(p.string())) merged.push_back(&p);
+	}
+	bool ordered = std::equal(kept.begin(), kept.end(), merged.begin(), merged.end(),
+		[](const fs::path* l, const fs::path* r) { return *l == *r; });
+	if (!ordered) {
+		beginResetModel();
+		rows = std::move(now);
+		endResetModel();
+		return;
+	}
+
+	// Removals from the back so earlier rows keep their numbers, then each run of new rows where
+	// it lands, which is its position in [files] once everything before it is in place
+	for (long ii = long(rows.size()) - 1; ii >= 0; ii --) {
+		if (after.count(rows[ii].string())) continue;
+		long first = ii;
+		while (first > 0 && !after.count(rows[first - 1].string())) first --;
+		beginRemoveRows(QModelIndex(), first, ii);
+		rows.erase(rows.begin() + first, rows.begin() + ii + 1);
+		endRemoveRows();
+		ii = first;
+	}
+	for (size_t ii = 0; ii < now.size(); ii ++) {
+		if (before.count(now[ii].string())) continue;
+		size_t last = ii;
+		while (last + 1 < now.size() && !before.count(now[last + 1].string())) last ++;
+		beginInsertRows(QModelIndex(), ii, last);
+		rows.insert(rows.begin() + ii, now.begin() + ii, now.begin() + last + 1);
+		endInsertRows();
+		ii = last;
+	}
+}
+
+void ThumbModel::ready(QString path) {
+	// Positions are only the same as in [files] once caught up
+	sync();
+	long i = files->indexOf(fs::path(path.toStdString()));
+	if (i < 0) return;
+	QModelIndex idx = index(i);
+	emit dataChanged(idx, idx, {Qt::DecorationRole});
+}
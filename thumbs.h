@@ -0,0 +1,128 @@
+/*
+ * thumbs.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Persistent thumbnail cache for PicoView minimal image viewer. Each
+ * directory gets an append-only pack of raw RGB thumbnails under the
+ * user cache dir, memory-mapped so cached thumbnails are drawn without
+ * decoding or copying anything. Packs are shared between processes,
+ * appends hold an flock and a pack is only ever replaced, not shrunk
+ *
+ */
+
+#pragma once
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <experimental/filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Qt
+#include <QAbstractListModel>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include "filelist.h"
+
+namespace fs = std::experimental::filesystem;
+
+class ThumbCache : public QObject {
+	Q_OBJECT
+
+public:
+	// Thumbnails are generated on {shared} if given, e.g. by a batch run over many directories,
+	// otherwise on a pool of its own
+	ThumbCache(QObject* parent = Q_NULLPTR, QThreadPool* shared = Q_NULLPTR);
+	~ThumbCache();
+
+	// Switch to the pack for {dir}, abandoning thumbnails still being generated for the last one
+	void open(const fs::path &dir);
+
+	// Thumbnail of {e} straight out of the mapped pack, null if it hasn't been generated.
+	// Valid until the next [open]
+	QImage find(const FileEntry &e);
+
+	// Generate the thumbnail of {e} in the background, [ready] follows
+	void request(const FileEntry &e);
+
+	// As [request], for the viewer stepping through files under key repeat. Only the latest is
+	// wanted, each call abandons the last one's decode wherever it has got to
+	void preview(const FileEntry &e);
+
+	// Block until every thumbnail requested so far has been stored, and anything else on a
+	// shared pool has finished too
+	void finish() { pool->waitForDone(); }
+
+	// Key on everything that changes when the file does
+	static uint64_t key(const FileEntry &e);
+
+	static const int size = 128;        // Longest edge in pixels
+
+signals:
+	void ready(QString path);
+
+private:
+	friend class ThumbTask;
+
+	struct Region {
+		size_t offset;                  // Within the pack file
+		size_t length;
+		unsigned char* data;
+	};
+
+	void close();
+	void abandon(uint64_t k);           // Forget a request that was given up, so it can be made again
+	void index(size_t size);            // Records from [end] up to {size} bytes into the pack
+	bool replace(const std::string &pack, size_t keep);
+	void store(int g, uint64_t k, const QImage &thumb);
+	const unsigned char* locate(size_t offset, size_t length);
+	bool isCurrent(int g) const { return g == generation.load(); }
+
+	QMutex mutex;
+	fs::path dir;
+	int fd = -1;
+	size_t end = 0;                     // Bytes of complete records in the pack, as far as indexed
+	std::vector<Region> regions;        // Mappings, each a window from a page boundary, reaching past [end]
+	std::unordered_map<uint64_t, size_t> records;
+	std::unordered_set<uint64_t> in_flight;
+	std::unordered_set<uint64_t> failed;  // Undecodable, not retried until the file changes
+	std::atomic<int> generation;
+	std::atomic<int> previews;          // Serial of the latest [preview]
+	QThreadPool* pool;
+	bool owned;                         // [pool] is this cache's own, not shared
+};
+
+// List model over the viewer's [FileList] for the filmstrip and grid views
+class ThumbModel : public QAbstractListModel {
+	Q_OBJECT
+
+public:
+	ThumbModel(FileList* _files, ThumbCache* _cache, QObject* parent = Q_NULLPTR);
+
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+	// Catch up with [files] if it has changed since the last call. Merges and removals go to the
+	// view as inserted and removed rows and a re-sort as a layout change, so its scroll position
+	// and selection survive. Only a change that is neither is a reset
+	void sync();
+
+private slots:
+	void ready(QString path);
+
+private:
+	FileList* files;
+	ThumbCache* cache;
+	uint64_t revision = 0;
+	std::vector<fs::path> rows;         // The rows the view knows about, [files] as of [revision]
+	QImage placeholder;
+};
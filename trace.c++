@@ -0,0 +1,122 @@
+/*
+ * trace.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Hot-path tracing for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "trace.h"
+
+namespace trace {
+
+namespace {
+
+const uint64_t capacity = 1 << 16;      // Events kept, the oldest are overwritten
+
+// Each slot is a small seqlock: [seq] is 0 while the slot is being written and the
+// event's index + 1 once it's complete, so readers can skip torn or lapped slots
+struct Slot {
+	std::atomic<uint64_t> seq{0};
+	std::atomic<const char*> name{nullptr};
+	std::atomic<int64_t> begin{0};
+	std::atomic<int64_t> end{0};
+	std::atomic<uint32_t> thread{0};
+};
+
+struct Event {
+	const char* name;
+	int64_t begin;
+	int64_t end;
+	uint32_t thread;
+};
+
+Slot ring[capacity];
+std::atomic<uint64_t> head(0);
+std::atomic<bool> on(false);
+std::atomic<uint32_t> threads(0);
+
+uint32_t thread() {
+	thread_local uint32_t id = ++threads;
+	return id;
+}
+
+// Copy out event {i} if it's still intact in the ring
+bool read(uint64_t i, Event &e) {
+	Slot &s = ring[i % capacity];
+	if (s.seq.load(std::memory_order_acquire) != i + 1) return false;
+	e.name = s.name.load(std::memory_order_relaxed);
+	e.begin = s.begin.load(std::memory_order_relaxed);
+	e.end = s.end.load(std::memory_order_relaxed);
+	e.thread = s.thread.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return s.seq.load(std::memory_order_relaxed) == i + 1;
+}
+
+}
+
+void enable(bool _on) { on.store(_on, std::memory_order_relaxed); }
+bool enabled() { return on.load(std::memory_order_relaxed); }
+
+int64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record(const char* name, int64_t begin, int64_t end) {
+	uint64_t i = head.fetch_add(1, std::memory_order_relaxed);
+	Slot &s = ring[i % capacity];
+	s.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	s.name.store(name, std::memory_order_relaxed);
+	s.begin.store(begin, std::memory_order_relaxed);
+	s.end.store(end, std::memory_order_relaxed);
+	s.thread.store(thread(), std::memory_order_relaxed);
+	s.seq.store(i + 1, std::memory_order_release);
+}
+
+int64_t last(const char* name) {
+	uint64_t h = head.load(std::memory_order_acquire);
+	Event e;
+	for (uint64_t i = h; i > 0 && h - i < capacity; i --) {
+		if (read(i - 1, e) && !strcmp(e.name, name)) return e.end - e.begin;
+	}
+	return -1;
+}
+
+bool save(const std::string &file) {
+	uint64_t h = head.load(std::memory_order_acquire);
+	std::vector<Event> events;
+	events.reserve(std::min(h, capacity));
+	Event e;
+	for (uint64_t i = h > capacity ? h - capacity : 0; i < h; i ++) {
+		if (read(i, e)) events.push_back(e);
+	}
+	std::sort(events.begin(), events.end(), [](const Event &l, const Event &r) { return l.begin < r.begin; });
+
+	std::unique_ptr<FILE, decltype(&fclose)> f(fopen(file.c_str(), "w"), fclose);
+	if (!f) return false;
+	int64_t origin = events.empty() ? 0 : events.front().begin;
+
+	// Complete ("X") events, timestamps in microseconds
+	fprintf(f.get(), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (size_t ii = 0; ii < events.size(); ii ++) {
+		const Event &ev = events[ii];
+		fprintf(f.get(), "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", ii ? "," : "",
+		        ev.name, ev.thread, (ev.begin - origin) / 1e3, (ev.end - ev.begin) / 1e3);
+	}
+	fprintf(f.get(), "\n]}\n");
+	return !ferror(f.get());
+}
+
+}
@@ -0,0 +1,56 @@
+/*
+ * trace.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Hot-path tracing for PicoView minimal image viewer. Scoped trace
+ * points record into a fixed lock-free ring buffer, cost one atomic
+ * load while tracing is off, and export as Chrome trace JSON
+ * (chrome://tracing, Perfetto)
+ *
+ */
+
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+
+namespace trace {
+
+// Switch recording on or off at runtime
+void enable(bool on);
+bool enabled();
+
+// Nanoseconds on a monotonic clock
+int64_t now();
+
+// Add a complete event, {name} must outlive the trace (string literals)
+void record(const char* name, int64_t begin, int64_t end);
+
+// Duration in nanoseconds of the most recent {name} event still in the buffer, -1 if none
+int64_t last(const char* name);
+
+// Write everything still in the buffer to {file} as Chrome trace JSON
+bool save(const std::string &file);
+
+// Records its own lifetime, if tracing was on when it started
+class Scope {
+public:
+	Scope(const char* _name) : name(_name), begin(enabled() ? now() : -1) {}
+	~Scope() { if (begin >= 0) record(name, begin, now()); }
+
+	Scope(const Scope&) = delete;
+	Scope &operator=(const Scope&) = delete;
+
+private:
+	const char* name;
+	int64_t begin;
+};
+
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(_trace_scope_, __LINE__)(name)
@@ -0,0 +1,134 @@
+/*
+ * trash.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Deferred, undoable deletion for PicoView minimal image viewer
+ *
+ */
+
+// std
+#include <functional>
+
+// POSIX
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Qt
+#include <QRunnable>
+
+#include "trash.h"
+
+const char* const Trash::name = ".picoview-trash";
+
+// Leftovers older than this are from a session that never got to commit
+static const time_t stale_seconds = 600;
+
+class TrashTask : public QRunnable {
+public:
+	TrashTask(std::function<void()> _fn) : fn(_fn) {}
+	void run() override { fn(); }
+
+private:
+	std::function<void()> fn;
+};
+
+static QString failure(const char* what, const fs::path &f, const std::error_code &ec) {
+	return QString::fromStdString(std::string(what)+" "+f.filename().string()+": "+ec.message()+".");
+}
+
+Trash::Trash(QObject* parent) : QObject(parent) {
+	qRegisterMetaType<fs::path>("fs::path");
+	pool.setMaxThreadCount(1);
+
+	timer = new QTimer(this);
+	timer->setSingleShot(true);
+	timer->setInterval(delay);
+	connect(timer, &QTimer::timeout, this, &Trash::commit);
+
+	// A file that never made it into the trash can't be undone or committed
+	connect(this, &Trash::failed, this, [this](fs::path f) {
+		for (size_t ii = 0; ii < entries.size(); ii ++) {
+			if (entries[ii].file == f) entries.erase(entries.begin() + ii--);
+		}
+	});
+}
+Trash::~Trash() {
+	commit();
+	pool.waitForDone();
+}
+
+void Trash::discard(const fs::path &f) {
+	Entry e = {f, location(f, serial++)};
+	entries.push_back(e);
+	timer->start();
+
+	// A rename within the same directory tree, nothing is copied
+	pool.start(new TrashTask([this, e]() {
+		std::error_code ec;
+		fs::create_directories(e.trashed.parent_path(), ec);
+		if (!ec) fs::rename(e.file, e.trashed, ec);
+		if (ec) emit failed(e.file, failure("Failed to remove", e.file, ec));
+	}));
+}
+
+fs::path Trash::undo() {
+	if (entries.empty()) return fs::path();
+	Entry e = entries.back();
+	entries.pop_back();
+
+	pool.start(new TrashTask([this, e]() {
+		std::error_code ec;
+		if (fs::exists(e.file, ec)) ec = std::make_error_code(std::errc::file_exists);
+		else fs::rename(e.trashed, e.file, ec);
+		if (ec) emit failed(e.file, failure("Failed to restore", e.file, ec));
+		else emit restored(e.file);
+	}));
+	return e.file;
+}
+
+void Trash::commit() {
+	timer->stop();
+	if (entries.empty()) return;
+	std::vector<Entry> batch;
+	batch.swap(entries);
+
+	pool.start(new TrashTask([this, batch]() {
+		for (const auto &e : batch) {
+			std::error_code ec;
+			if (!fs::remove(e.trashed, ec) && ec) emit failed(e.file, failure("Failed to remove", e.file, ec));
+		}
+
+		// Drop the trash directories once they're empty, a non-empty one just stays
+		for (const auto &e : batch) {
+			std::error_code ec;
+			fs::remove(e.trashed.parent_path(), ec);
+		}
+	}));
+}
+
+void Trash::sweep(const fs::path &dir) {
+	pool.start(new TrashTask([dir]() {
+		fs::path trash = dir / name;
+		std::error_code ec;
+		if (!fs::is_directory(trash, ec)) return;
+
+		// Renaming a file into the trash set its ctime, so that's when it was discarded
+		time_t now = time(nullptr);
+		for (fs::directory_iterator it(trash, ec), end; !ec && it != end; it.increment(ec)) {
+			struct stat st;
+			if (::stat(it->path().c_str(), &st) == 0 && now - st.st_ctime > stale_seconds) {
+				std::error_code rc;
+				fs::remove(it->path(), rc);
+			}
+		}
+		fs::remove(trash, ec);
+	}));
+}
+
+fs::path Trash::location(const fs::path &f, unsigned long serial) {
+	// Unique across sessions and concurrent instances sharing a directory
+	return f.parent_path() / name / (std::to_string(getpid())+"-"+std::to_string(serial)+"-"+f.filename().string());
+}
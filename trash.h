@@ -0,0 +1,70 @@
+/*
+ * trash.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * Deferred, undoable deletion for PicoView minimal image viewer. Deleted
+ * files are moved aside into a hidden trash next to them on a background
+ * thread, and only removed for good in batches once deleting has paused
+ *
+ */
+
+#pragma once
+
+// std
+#include <experimental/filesystem>
+#include <vector>
+
+// Qt
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+
+namespace fs = std::experimental::filesystem;
+
+Q_DECLARE_METATYPE(fs::path)
+
+class Trash : public QObject {
+	Q_OBJECT
+
+public:
+	Trash(QObject* parent = Q_NULLPTR);
+	~Trash();                           // Commits everything still pending
+
+	// Move {f} to the trash in the background. It can be brought back with [undo] until committed
+	void discard(const fs::path &f);
+
+	// Bring back the most recent discard still pending, returns its path or an empty one
+	fs::path undo();
+
+	// Delete everything pending for good
+	void commit();
+
+	// Remove what a previous session left in the trash of {dir}
+	void sweep(const fs::path &dir);
+
+	size_t pending() const { return entries.size(); }
+
+	static const char* const name;      // Trash directory, created inside the directory of each file
+	static const int delay = 30000;     // Milliseconds after the last discard before committing
+
+signals:
+	void restored(fs::path f);
+	void failed(fs::path f, QString message);    // {message} is ready to show
+
+private:
+	struct Entry {
+		fs::path file;
+		fs::path trashed;
+	};
+
+	static fs::path location(const fs::path &f, unsigned long serial);
+
+	std::vector<Entry> entries;         // Oldest first
+	unsigned long serial = 0;
+	QTimer* timer;
+	QThreadPool pool;                   // One thread, so moves, restores and commits happen in order
+};
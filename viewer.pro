@@ -0,0 +1,8 @@
+TEMPLATE = app
+TARGET = ~/bin/picoview
+
+include(picoview.pri)
+QT += network
+
+SOURCES += main.c++ instance.c++ batch.c++
+HEADERS += instance.h batch.h
@@ -0,0 +1,70 @@
+/*
+ * watcher.c++
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * inotify-backed directory change feed for PicoView minimal
+ * image viewer
+ *
+ */
+
+// POSIX
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "watcher.h"
+
+DirWatcher::DirWatcher(QObject* parent) : QObject(parent) {
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0) return;
+	notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+	connect(notifier, &QSocketNotifier::activated, this, &DirWatcher::readEvents);
+}
+DirWatcher::~DirWatcher() {
+	if (fd >= 0) close(fd);
+}
+
+bool DirWatcher::watch(const fs::path &_dir) {
+	if (fd < 0) return false;
+	if (wd >= 0 && _dir == dir) return true;
+	stop();
+
+	// Files are picked up once fully written (or moved in whole), not on creation
+	dir = _dir;
+	wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM |
+	                                        IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	return wd >= 0;
+}
+
+void DirWatcher::stop() {
+	if (wd >= 0) inotify_rm_watch(fd, wd);
+	wd = -1;
+}
+
+void DirWatcher::readEvents() {
+	alignas(struct inotify_event) char buffer[16384];
+	ssize_t n;
+	while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+		for (char* p = buffer; p < buffer + n; ) {
+			const struct inotify_event* e = reinterpret_cast<const struct inotify_event*>(p);
+			p += sizeof(struct inotify_event) + e->len;
+
+			if (e->mask & IN_Q_OVERFLOW) {
+				emit overflowed();
+				continue;
+			}
+			if (e->wd != wd) continue;
+			if (e->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+				wd = -1;
+				emit overflowed();
+				continue;
+			}
+			if (e->len == 0 || (e->mask & IN_ISDIR)) continue;
+
+			fs::path f = dir / e->name;
+			if (e->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) emit changed(f);
+			else if (e->mask & (IN_DELETE | IN_MOVED_FROM)) emit removed(f);
+		}
+	}
+}
@@ -0,0 +1,51 @@
+/*
+ * watcher.h
+ *
+ * William Miller
+ * Oct 17, 2026
+ *
+ * inotify-backed directory change feed for PicoView minimal
+ * image viewer, reports files as they are added and removed
+ * so the file list never needs a full rescan
+ *
+ */
+
+#pragma once
+
+// std
+#include <experimental/filesystem>
+
+// Qt
+#include <QObject>
+#include <QSocketNotifier>
+
+namespace fs = std::experimental::filesystem;
+
+class DirWatcher : public QObject {
+	Q_OBJECT
+
+public:
+	DirWatcher(QObject* parent = Q_NULLPTR);
+	~DirWatcher();
+
+	// Start watching {dir}, replacing any previous watch. Returns false if
+	// inotify isn't available, in which case callers should rescan as before
+	bool watch(const fs::path &dir);
+	void stop();
+
+	bool isWatching() const { return wd >= 0; }
+
+signals:
+	void changed(const fs::path &f);    // Created, rewritten or moved in
+	void removed(const fs::path &f);    // Deleted or moved out
+	void overflowed();                  // Events were lost, the directory must be rescanned
+
+private slots:
+	void readEvents();
+
+private:
+	int fd = -1;
+	int wd = -1;
+	fs::path dir;
+	QSocketNotifier* notifier = Q_NULLPTR;
+};